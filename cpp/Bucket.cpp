@@ -0,0 +1,81 @@
+/**
+ *  @file   Bucket.cpp
+ *  @brief  Bucket Class Implementation
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#include "Bucket.h"
+
+void Bucket::configure(double rate, double burst) {
+
+  this->rate = rate;
+
+  this->burst = std::max(burst, 1.0);
+
+  this->tokens = this->burst;
+
+  timerclear(&this->last);
+}
+
+bool Bucket::ready(const struct timeval &now) {
+
+  if (this->rate <= 0) {
+
+    return true;
+  }
+
+  this->refill(now);
+
+  return this->tokens >= 1.0;
+}
+
+void Bucket::take() {
+
+  if (this->rate > 0) {
+
+    this->tokens -= 1.0;
+  }
+}
+
+long Bucket::wait(const struct timeval &now) const {
+
+  if (this->rate <= 0) {
+
+    return 0;
+  }
+
+  struct timeval elapsed;
+
+  timersub(&now, &this->last, &elapsed);
+
+  double tokens = std::min(this->burst,
+                           this->tokens + this->rate * (elapsed.tv_sec +
+                                                        elapsed.tv_usec / 1e6));
+
+  if (tokens >= 1.0) {
+
+    return 0;
+  }
+
+  // round up so the wake-up never comes just short of the next token
+  return (long)((1.0 - tokens) * 1000.0 / this->rate) + 1;
+}
+
+void Bucket::refill(const struct timeval &now) {
+
+  if (timerisset(&this->last)) {
+
+    struct timeval elapsed;
+
+    timersub(&now, &this->last, &elapsed);
+
+    this->tokens =
+        std::min(this->burst, this->tokens + this->rate * (elapsed.tv_sec +
+                                                           elapsed.tv_usec / 1e6));
+  }
+
+  this->last = now;
+}
@@ -0,0 +1,39 @@
+/**
+ *  @file   Bucket.h
+ *  @brief  Bucket Class Definition
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#ifndef BUCKET_H_
+#define BUCKET_H_
+
+#include <algorithm>
+
+#include <sys/time.h>
+
+class Bucket {
+
+public:
+  Bucket(double rate = 0, double burst = 1) { this->configure(rate, burst); }
+  ~Bucket() = default;
+
+  void configure(double rate, double burst);
+
+  bool ready(const struct timeval &now);
+  void take();
+  long wait(const struct timeval &now) const;
+
+private:
+  double rate;
+  double burst;
+  double tokens;
+
+  struct timeval last = {};
+
+  void refill(const struct timeval &now);
+};
+
+#endif
@@ -0,0 +1,46 @@
+/**
+ *  @file   Description.cpp
+ *  @brief  Description Class Implementation
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#include "Description.h"
+
+std::string *Description::open(std::string_view element) {
+
+  std::string *field = nullptr;
+
+  if (element == "deviceType") {
+
+    field = &this->type;
+  } else if (element == "friendlyName") {
+
+    field = &this->name;
+  } else if (element == "UDN") {
+
+    field = &this->udn;
+  } else if (element == "modelName") {
+
+    field = &this->model;
+  } else if (element == "serialNumber") {
+
+    field = &this->serial;
+  } else if (element == "firmwareVersion") {
+
+    field = &this->firmware;
+  } else if (element == "macAddress") {
+
+    field = &this->mac;
+  }
+
+  // only the root device counts, embedded devices come later in the document
+  if (field && !field->empty()) {
+
+    return nullptr;
+  }
+
+  return field;
+}
@@ -0,0 +1,38 @@
+/**
+ *  @file   Description.h
+ *  @brief  Description Class Definition
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#ifndef DESCRIPTION_H_
+#define DESCRIPTION_H_
+
+#include <string>
+#include <string_view>
+
+#include "Markup.h"
+
+class Description : public Markup {
+
+public:
+  Description() = default;
+  ~Description() = default;
+
+  bool complete() const { return this->name.size() > 0 && this->udn.size() > 0; }
+
+  std::string type;
+  std::string name;
+  std::string udn;
+  std::string model;
+  std::string serial;
+  std::string firmware;
+  std::string mac;
+
+protected:
+  std::string *open(std::string_view element) override;
+};
+
+#endif
@@ -11,9 +11,91 @@
 
 const char *Discover::ADDRESS = "239.255.255.250";
 
-bool Discover::setup() {
+const char *Discover::TARGETS[] = {"urn:Belkin:device:controllee:1",
+                                   "urn:Belkin:device:insight:1",
+                                   "urn:Belkin:device:lightswitch:1"};
 
-  if (-1 == (this->fd_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP))) {
+bool Discover::setup(const std::vector<std::string> &filter) {
+
+  this->shutdown();
+
+  this->filter = filter;
+
+  struct ifaddrs *ifaddr, *ifa;
+
+  if (-1 == getifaddrs(&ifaddr)) {
+
+    Log::perror("Failed to enumerate network interfaces");
+  } else {
+
+    for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
+
+      if (ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_INET ||
+          !(ifa->ifa_flags & IFF_UP) || !(ifa->ifa_flags & IFF_MULTICAST) ||
+          (ifa->ifa_flags & IFF_LOOPBACK)) {
+
+        continue;
+      }
+
+      if (!filter.empty() &&
+          std::find(filter.begin(), filter.end(), ifa->ifa_name) ==
+              filter.end()) {
+
+        continue;
+      }
+
+      Discover::Interface iface = {
+          ifa->ifa_name, ((struct sockaddr_in *)ifa->ifa_addr)->sin_addr, -1,
+          0};
+
+      if (this->open(iface)) {
+
+        this->interfaces.push_back(iface);
+      }
+    }
+
+    freeifaddrs(ifaddr);
+  }
+
+  if (this->interfaces.empty()) {
+
+    if (!filter.empty()) {
+
+      Log::warn("No usable multicast interface among the configured ones");
+    }
+
+    Discover::Interface iface = {"any", {htonl(INADDR_ANY)}, -1, 0};
+
+    if (this->open(iface)) {
+
+      this->interfaces.push_back(iface);
+    }
+  }
+
+  for (std::vector<Discover::Interface>::iterator it =
+           this->interfaces.begin();
+       it != this->interfaces.end(); it++) {
+
+    Log::info("Discovering Plugs on %s (%s)", it->name.c_str(),
+              inet_ntoa(it->addr));
+  }
+
+  return this->listen() && !this->interfaces.empty();
+}
+
+bool Discover::configure(const std::vector<std::string> &filter) {
+
+  if (filter == this->filter) {
+
+    return true;
+  }
+
+  return this->setup(filter);
+}
+
+bool Discover::open(Discover::Interface &iface) {
+
+  if (-1 == (iface.fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP))) {
 
     Log::perror("Failed to open UDP socket");
 
@@ -22,21 +104,17 @@ bool Discover::setup() {
 
   const int yes = 1, no = 0;
 
-  struct in_addr addr_if;
+  int flags;
+  if (-1 == (flags = fcntl(iface.fd, F_GETFL)) ||
+      -1 == fcntl(iface.fd, F_SETFL, flags | O_NONBLOCK)) {
 
-  struct timeval rcvtimeo;
-  rcvtimeo.tv_sec = 1;
-  rcvtimeo.tv_usec = 0;
-  if (-1 == setsockopt(this->fd_socket, SOL_SOCKET, SO_RCVTIMEO,
-                       (const char *)&rcvtimeo, sizeof(rcvtimeo))) {
-
-    Log::perror("Failed to set socket timeout");
+    Log::perror("Failed to set socket non-blocking");
 
     goto FAIL;
   }
 
   if (-1 ==
-      setsockopt(fd_socket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes))) {
+      setsockopt(iface.fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes))) {
 
     Log::perror("Failed to set socket reuse address");
 
@@ -44,25 +122,25 @@ bool Discover::setup() {
   }
 
   if (-1 ==
-      setsockopt(fd_socket, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes))) {
+      setsockopt(iface.fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes))) {
 
     Log::perror("Failed to set socket reuse port");
 
     goto FAIL;
   }
 
-  if (-1 == 
-      setsockopt(fd_socket, IPPROTO_IP, IP_MULTICAST_LOOP, &no, sizeof(no))) {
+  if (-1 ==
+      setsockopt(iface.fd, IPPROTO_IP, IP_MULTICAST_LOOP, &no, sizeof(no))) {
 
     Log::perror("Failed to set multicast loop");
 
     goto FAIL;
   }
 
-  addr_if.s_addr = INADDR_ANY;
-  if (setsockopt(fd_socket, IPPROTO_IP, IP_MULTICAST_IF, &addr_if, sizeof(addr_if))) {
+  if (setsockopt(iface.fd, IPPROTO_IP, IP_MULTICAST_IF, &iface.addr,
+                 sizeof(iface.addr))) {
 
-    Log::perror("Failed setting multicast interface");
+    Log::perror("Failed setting multicast interface %s", iface.name.c_str());
 
     goto FAIL;
   }
@@ -70,24 +148,134 @@ bool Discover::setup() {
   return true;
 
 FAIL:
-  close(this->fd_socket);
-  this->fd_socket = -1;
+  close(iface.fd);
+  iface.fd = -1;
   return false;
 }
 
-Discover::~Discover() {
+bool Discover::listen() {
+
+  if (-1 == (this->fd_notify = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP))) {
+
+    Log::perror("Failed to open UDP socket for notifications");
+
+    return false;
+  }
+
+  const int yes = 1;
+
+  struct sockaddr_in addr;
 
-  if(this->fd_socket != -1) {
+  struct ip_mreq mreq;
 
-    close(this->fd_socket);
+  int joined = 0;
+
+  int flags;
+  if (-1 == (flags = fcntl(this->fd_notify, F_GETFL)) ||
+      -1 == fcntl(this->fd_notify, F_SETFL, flags | O_NONBLOCK)) {
+
+    Log::perror("Failed to set socket non-blocking");
+
+    goto FAIL;
+  }
+
+  if (-1 ==
+      setsockopt(fd_notify, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes))) {
+
+    Log::perror("Failed to set socket reuse address");
+
+    goto FAIL;
+  }
+
+  if (-1 ==
+      setsockopt(fd_notify, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes))) {
+
+    Log::perror("Failed to set socket reuse port");
+
+    goto FAIL;
+  }
+
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(Discover::PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  memset(&addr.sin_zero, '\0', 8);
+
+  if (-1 == bind(fd_notify, (struct sockaddr *)&addr, sizeof(addr))) {
+
+    Log::perror("Failed to bind to SSDP port %d", Discover::PORT);
+
+    goto FAIL;
+  }
+
+  if (0 == inet_aton(Discover::ADDRESS, &mreq.imr_multiaddr)) {
+
+    Log::perror("Failed to set multicast group address");
+
+    goto FAIL;
+  }
+
+  for (std::vector<Discover::Interface>::iterator it =
+           this->interfaces.begin();
+       it != this->interfaces.end(); it++) {
+
+    mreq.imr_interface = it->addr;
+
+    if (-1 == setsockopt(fd_notify, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq,
+                         sizeof(mreq))) {
+
+      Log::perror("Failed to join multicast group on %s", it->name.c_str());
+
+      continue;
+    }
+
+    ++joined;
   }
+
+  if (joined == 0) {
+
+    goto FAIL;
+  }
+
+  Log::info("Listening for SSDP notifications on %s:%d", Discover::ADDRESS,
+            Discover::PORT);
+
+  return true;
+
+FAIL:
+  close(this->fd_notify);
+  this->fd_notify = -1;
+  return false;
 }
 
+void Discover::shutdown() {
+
+  for (std::vector<Discover::Interface>::iterator it =
+           this->interfaces.begin();
+       it != this->interfaces.end(); it++) {
+
+    if (it->fd != -1) {
+
+      close(it->fd);
+    }
+  }
+
+  this->interfaces.clear();
+
+  if (this->fd_notify != -1) {
+
+    close(this->fd_notify);
+
+    this->fd_notify = -1;
+  }
+}
+
+Discover::~Discover() { this->shutdown(); }
+
 bool Discover::discover() {
 
-  if (this->fd_socket == -1) {
+  if (this->interfaces.empty()) {
 
-    if(!this->setup()) {
+    if (!this->setup(this->filter)) {
 
       Log::err("Failed to set up socket");
 
@@ -95,151 +283,652 @@ bool Discover::discover() {
     }
   }
 
+  if (this->state) {
+
+    Log::warn("Scan for Plugs already in progress");
+
+    return true;
+  }
+
   Log::info("Scanning for Plugs");
 
   destroy();
 
+  if (-1 == gettimeofday(&this->started, NULL)) {
+
+    Log::perror("Failed to get time of day");
+
+    return false;
+  }
+
   if (!this->broadcast()) {
 
     return false;
   }
 
-  return this->receive();
+  this->deadline = this->started;
+
+  this->deadline.tv_sec += this->mx;
+
+  this->bursts = 1;
+
+  this->schedule();
+
+  for (Registry::iterator it = this->plugs.begin(); it != this->plugs.end();
+       it++) {
+
+    this->expected.insert(it->first);
+  }
+
+  this->state = true;
+
+  return true;
 }
 
-void Discover::destroy() { this->plugs.clear(); }
+void Discover::schedule() {
+
+  long spacing = 1000000L * this->mx / (Discover::BURSTS + 1);
+
+  long usec = spacing * this->bursts +
+              std::uniform_int_distribution<long>(0, spacing / 4)(this->rng);
+
+  struct timeval offset = {usec / 1000000L, usec % 1000000L};
+
+  timeradd(&this->started, &offset, &this->next);
+}
+
+void Discover::destroy() {
+
+  this->found = 0;
+
+  this->seen.clear();
+
+  this->expected.clear();
+}
+
+int Discover::fds(fd_set *fd_in) const {
+
+  int fd_max = -1;
+
+  for (std::vector<Discover::Interface>::const_iterator it =
+           this->interfaces.begin();
+       it != this->interfaces.end(); it++) {
+
+    if (it->fd != -1) {
+
+      FD_SET(it->fd, fd_in);
+
+      fd_max = std::max(fd_max, it->fd);
+    }
+  }
+
+  if (this->fd_notify != -1) {
+
+    FD_SET(this->fd_notify, fd_in);
+
+    fd_max = std::max(fd_max, this->fd_notify);
+  }
+
+  return fd_max;
+}
+
+struct timeval *Discover::timeout(struct timeval *tv) const {
+
+  struct timeval now, next;
+
+  timerclear(&next);
+
+  bool pending = this->state;
+  if (pending) {
+
+    next = this->bursts < Discover::BURSTS &&
+                   timercmp(&this->next, &this->deadline, <)
+               ? this->next
+               : this->deadline;
+  }
+
+  for (Registry::const_iterator it = this->plugs.begin();
+       it != this->plugs.end(); it++) {
+
+    if (!pending || it->second->expires < next.tv_sec) {
+
+      next.tv_sec = it->second->expires;
+      next.tv_usec = 0;
+
+      pending = true;
+    }
+  }
+
+  if (!pending) {
+
+    return nullptr;
+  }
+
+  gettimeofday(&now, NULL);
+
+  if (timercmp(&now, &next, >=)) {
+
+    timerclear(tv);
+  } else {
+
+    timersub(&next, &now, tv);
+  }
+
+  return tv;
+}
+
+bool Discover::expire() {
+
+  bool changed = false;
+
+  size_t before = this->churn;
+
+  time_t now = time(NULL);
+
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+
+  if (this->state && this->bursts < Discover::BURSTS &&
+      timercmp(&tv, &this->next, >=) && timercmp(&tv, &this->deadline, <)) {
+
+    this->broadcast();
+
+    ++this->bursts;
+
+    this->schedule();
+  }
+
+  if (this->state && timercmp(&tv, &this->deadline, >=)) {
+
+    this->state = false;
+
+    Log::info("Scan finished: found %zu new Plug(s)", this->found);
+
+    this->describe();
+
+    changed = this->found > 0;
+
+    destroy();
+
+    this->plugs.save(true);
+  }
+
+  Registry::iterator it = this->plugs.begin();
+  while (it != this->plugs.end()) {
+
+    if (it->second->expires <= now) {
+
+      Log::info("Lease expired for Plug at %s", it->second->ip.c_str());
+
+      it = this->plugs.erase(it);
+
+      ++this->churn;
+    } else {
+
+      it++;
+    }
+  }
+
+  if (changed) {
+
+    this->discovered();
+  }
+
+  if (this->churn != before) {
+
+    this->churned();
+  }
+
+  this->plugs.save();
+
+  return changed;
+}
 
 bool Discover::broadcast() {
 
   struct sockaddr_in mc;
 
-  std::string msg = "M-SEARCH * HTTP/1.1\r\n"
-                    "HOST: " +
-                    std::string(Discover::ADDRESS) + ":" +
-                    std::to_string(Discover::PORT) +
-                    "\r\n"
-                    "MAN: \"ssdp:discover\"\r\n"
-                    "MX: " + std::to_string(this->mx) +"\r\n"
-                    //"ST: ssdp:all\r\n"
-                    "ST: urn:Belkin:device:controllee:1\r\n"
-                    "USER-AGENT: WeMo Daemon\r\n"
-                    "\r\n";
+  std::string msgs[sizeof(Discover::TARGETS) / sizeof(*Discover::TARGETS)];
+
+  for (size_t i = 0; i < sizeof(msgs) / sizeof(*msgs); i++) {
+
+    msgs[i] = "M-SEARCH * HTTP/1.1\r\n"
+              "HOST: " +
+              std::string(Discover::ADDRESS) + ":" +
+              std::to_string(Discover::PORT) +
+              "\r\n"
+              "MAN: \"ssdp:discover\"\r\n"
+              "MX: " +
+              std::to_string(this->mx) +
+              "\r\n"
+              "ST: " +
+              Discover::TARGETS[i] +
+              "\r\n"
+              "USER-AGENT: WeMo Daemon\r\n"
+              "\r\n";
+  }
+
+  int sent = 0;
 
   mc.sin_family = AF_INET;
   mc.sin_port = htons(Discover::PORT);
   if (0 == inet_aton(Discover::ADDRESS, &mc.sin_addr)) {
 
     Log::perror("Failed to set multicast broadcast address");
-  
-    goto FAIL;
+
+    return false;
   }
   memset(&mc.sin_zero, '\0', 8);
 
+  for (std::vector<Discover::Interface>::iterator it =
+           this->interfaces.begin();
+       it != this->interfaces.end(); it++) {
 
-  if (-1 == sendto(this->fd_socket, msg.c_str(), msg.size(), 0,
-                   (struct sockaddr *)&mc, sizeof(struct sockaddr))) {
+    if (it->fd == -1) {
 
-    Log::perror("Failed to send multicast message");
-  
-    goto FAIL;
+      continue;
+    }
+
+    for (size_t i = 0; i < sizeof(msgs) / sizeof(*msgs); i++) {
+
+      if (-1 == sendto(it->fd, msgs[i].c_str(), msgs[i].size(), 0,
+                       (struct sockaddr *)&mc, sizeof(struct sockaddr))) {
+
+        Log::perror("Failed to send multicast message on %s",
+                    it->name.c_str());
+
+        goto FAIL;
+      }
+    }
+
+    if (0 == it->port) {
+
+      struct sockaddr_in local;
+      socklen_t len = sizeof(struct sockaddr);
+      if (-1 == getsockname(it->fd, (sockaddr *)&local, &len)) {
+
+        Log::perror("Failed to get UDP port");
+
+        goto FAIL;
+      }
+
+      it->port = ntohs(local.sin_port);
+
+      Log::info("Receiving UDP on %s port %d", it->name.c_str(), it->port);
+    }
+
+    ++sent;
+
+    continue;
+
+  FAIL:
+    close(it->fd);
+    it->fd = -1;
+  }
+
+  return sent > 0;
+}
+
+bool Discover::receive(int fd) {
+
+  struct mmsghdr msgs[Discover::BATCH];
+  struct iovec iovecs[Discover::BATCH];
+
+  for (size_t i = 0; i < Discover::BATCH; i++) {
+
+    iovecs[i].iov_base = this->buffs[i];
+    iovecs[i].iov_len = sizeof(this->buffs[i]);
+
+    memset(&msgs[i], 0, sizeof(msgs[i]));
+    msgs[i].msg_hdr.msg_iov = &iovecs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  bool changed = false;
+
+  int n;
+  while ((n = recvmmsg(fd, msgs, Discover::BATCH, MSG_DONTWAIT, NULL)) > 0) {
+
+    for (int i = 0; i < n; i++) {
+
+      Discover::Message m;
+
+      if (parse(std::string_view(this->buffs[i], msgs[i].msg_len), m)) {
+
+        changed |= this->process(m);
+      }
+    }
+
+    if (n < (int)Discover::BATCH) {
+
+      return changed;
+    }
+  }
+
+  if (n == -1 && !(errno == EAGAIN || errno == EWOULDBLOCK)) {
+
+    Log::perror("Error while receiving response");
+  }
+
+  return changed;
+}
+
+bool Discover::process(const Discover::Message &m) {
+
+  if (m.st.find("urn:Belkin:device:") == std::string_view::npos) {
+
+    return false;
+  }
+
+  bool alive = !m.notify || Discover::iequals(m.nts, "ssdp:alive");
+
+  if (alive && this->state && !m.usn.empty() &&
+      !this->seen.emplace(m.usn).second) {
+
+    return false;
+  }
+
+  std::string udn(m.usn.substr(0, m.usn.find("::")));
+
+  if (m.notify && Discover::iequals(m.nts, "ssdp:byebye")) {
+
+    Registry::Handle plug;
+    if (!udn.empty() && (plug = this->plugs.find(udn))) {
+
+      Log::info("Plug at %s said goodbye", plug->ip.c_str());
+
+      this->plugs.erase(udn);
+
+      ++this->churn;
+    }
+
+    return false;
+  }
+
+  std::string_view location = m.location;
+
+  if (!alive || location.substr(0, 7) != "http://") {
+
+    return false;
+  }
+
+  location.remove_prefix(7);
+
+  std::string_view::size_type colon = location.find(':');
+  if (colon == std::string_view::npos) {
+
+    return false;
+  }
+
+  std::string ip(location.substr(0, colon));
+
+  int p = 0;
+  std::from_chars(location.data() + colon + 1,
+                  location.data() + location.size(), p);
+
+  std::string_view::size_type slash = location.find('/', colon);
+
+  time_t age = Discover::max_age;
+
+  std::string_view::size_type a;
+  for (a = 0; a + 7 <= m.cache.size(); a++) {
+
+    if (Discover::iequals(m.cache.substr(a, 7), "max-age")) {
+
+      break;
+    }
   }
 
-  if (0 == port) {
-    socklen_t len = sizeof(struct sockaddr);
-    if (-1 == getsockname(fd_socket, (sockaddr *)&mc, &len)) {
+  if (a + 7 <= m.cache.size() &&
+      (a = m.cache.find('=', a)) != std::string_view::npos) {
+
+    std::string_view v = m.cache.substr(a + 1);
+
+    v.remove_prefix(std::min(v.find_first_not_of(' '), v.size()));
+
+    std::from_chars(v.data(), v.data() + v.size(), age);
+  }
+
+  Registry::Handle plug =
+      udn.empty() ? this->plugs.find_ip(ip) : this->plugs.find(udn);
+
+  time_t now = time(NULL);
 
-      Log::perror("Failed to get UDP port");
+  if (plug && !m.notify && this->state) {
 
-      goto FAIL;
+    this->respond(plug, udn.empty() ? ip : udn);
+  }
+
+  if (plug) {
+
+    if (this->plugs.move(plug, ip, p)) {
+
+      ++this->churn;
     }
 
-    port = ntohs(mc.sin_port);
+    if (slash != std::string_view::npos) {
+
+      plug->location = location.substr(slash);
+    }
+
+    bool stale = this->refresh(plug, m);
+
+    if (plug->stale) {
+
+      Log::info("Confirmed Plug '%s' at %s:%d", plug->name.c_str(), ip.c_str(),
+                p);
+
+      plug->stale = false;
+    }
+
+    plug->seen = now;
+
+    plug->lease = age;
+
+    plug->expires = now + age;
+
+    return stale;
+  }
+
+  plug = this->plugs.add(udn, ip, p);
+
+  ++this->churn;
 
-    Log::info("Receiving UDP on port %d", port);
+  if (slash != std::string_view::npos) {
+
+    plug->location = location.substr(slash);
   }
 
+  this->refresh(plug, m);
+
+  plug->seen = now;
+
+  plug->lease = age;
+
+  plug->expires = now + age;
+
+  if (!m.notify && this->state) {
+
+    this->respond(plug, udn.empty() ? ip : udn);
+
+    Log::info("Found Plug at %s:%d", ip.c_str(), p);
+
+    ++this->found;
+
+    return false;
+  }
+
+  Log::info("Plug announced at %s:%d", ip.c_str(), p);
+
   return true;
+}
 
-FAIL:
-  close(this->fd_socket);
-  this->fd_socket = -1;
-  return false;
+bool Discover::refresh(const Registry::Handle &plug,
+                       const Discover::Message &m) {
+
+  long boot_id = plug->boot_id, config_id = plug->config_id;
+
+  std::from_chars(m.bootid.data(), m.bootid.data() + m.bootid.size(), boot_id);
+  std::from_chars(m.configid.data(), m.configid.data() + m.configid.size(),
+                  config_id);
+
+  if (boot_id != plug->boot_id || config_id != plug->config_id) {
+
+    plug->boot_id = boot_id;
+
+    plug->config_id = config_id;
+
+    plug->described = false;
+
+    // a rebooted plug forgot its subscription and maybe its relay state
+    plug->sid.clear();
+
+    plug->evented = false;
+
+    plug->state = -1;
+
+    plug->renew = 0;
+  }
+
+  return !plug->described;
 }
 
-bool Discover::receive() {
+void Discover::describe() {
 
-  struct sockaddr_in from;
-  socklen_t from_size = sizeof(struct sockaddr);
-  char buff[2048];
-  time_t timeout = time(NULL) + this->mx;
-  ssize_t bytes;
+  for (Registry::iterator it = this->plugs.begin(); it != this->plugs.end();
+       it++) {
 
-  while (time(NULL) < timeout) {
+    if (!it->second->described && !it->second->describing) {
 
-    memset(&from, 0, from_size);
+      this->describe(it->second);
+    }
+  }
+}
 
-    if (-1 == (bytes = recvfrom(this->fd_socket, buff, sizeof(buff), 0,
-                                (struct sockaddr *)&from, &from_size))) {
+void Discover::respond(const Registry::Handle &plug, const std::string &key) {
 
-      if (!(errno == EAGAIN || errno == EWOULDBLOCK)) {
+  struct timeval now, latency;
+  gettimeofday(&now, NULL);
 
-        Log::perror("Error while receiving response");
-      }
+  if (plug) {
 
-      continue;
+    timersub(&now, &this->started, &latency);
+
+    plug->latency = latency.tv_sec * 1000L + latency.tv_usec / 1000L;
+  }
+
+  if (this->expected.erase(key) && this->expected.empty()) {
+
+    Log::info("All known Plugs responded, finishing scan early");
+
+    this->deadline = now;
+  }
+}
+
+bool Discover::parse(std::string_view msg, Discover::Message &m) {
+
+  std::string_view::size_type eol = msg.find('\n');
+
+  std::string_view line = msg.substr(0, eol);
+
+  if (line.substr(0, 7) == "NOTIFY ") {
+
+    m.notify = true;
+  } else if (line.substr(0, 12) == "HTTP/1.1 200") {
+
+    m.notify = false;
+  } else {
+
+    return false;
+  }
+
+  while (eol != std::string_view::npos) {
+
+    msg.remove_prefix(eol + 1);
+
+    eol = msg.find('\n');
+
+    line = msg.substr(0, eol);
+
+    if (!line.empty() && line.back() == '\r') {
+
+      line.remove_suffix(1);
     }
 
-    char *location = NULL;
+    std::string_view::size_type colon = line.find(':');
+    if (colon == std::string_view::npos) {
 
-    if (bytes > 0) {
+      continue;
+    }
 
-      buff[bytes] = '\0';
+    std::string_view name = line.substr(0, colon), value = line.substr(colon + 1);
 
-      if ((location = strstr(buff, "LOCATION: ")) != NULL) {
+    value.remove_prefix(std::min(value.find_first_not_of(" \t"), value.size()));
 
-        location += 10;
+    if (Discover::iequals(name, m.notify ? "NT" : "ST")) {
 
-        char *ip = NULL;
-        if ((ip = strstr(location, "http://")) != NULL) {
+      m.st = value;
+    } else if (Discover::iequals(name, "NTS")) {
 
-          ip += 7;
+      m.nts = value;
+    } else if (Discover::iequals(name, "USN")) {
 
-          char *port = NULL;
-          if ((port = strchr(ip, ':')) != NULL) {
+      m.usn = value;
+    } else if (Discover::iequals(name, "LOCATION")) {
 
-            *port++ = '\0';
+      m.location = value;
+    } else if (Discover::iequals(name, "CACHE-CONTROL")) {
 
-            int p = atoi(port);
+      m.cache = value;
+    } else if (Discover::iequals(name, "BOOTID.UPNP.ORG")) {
 
-            Log::info("Found Plug at %s:%d", ip, p);
+      m.bootid = value;
+    } else if (Discover::iequals(name, "CONFIGID.UPNP.ORG")) {
 
-            this->plugs.emplace_back(ip, p);
-          }
-        }
-      }
+      m.configid = value;
     }
   }
 
   return true;
 }
 
-void Discover::message() {
+bool Discover::iequals(std::string_view a, std::string_view b) {
+
+  return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+void Discover::message(const fd_set *fd_in) {
+
+  bool changed = false;
 
-  struct sockaddr_in from;
-  socklen_t from_size = sizeof(struct sockaddr);
-  char buff[2048];
-  ssize_t bytes;
+  size_t before = this->churn;
 
-  Log::info("RECEIVING MESSAGE");
+  for (std::vector<Discover::Interface>::iterator it =
+           this->interfaces.begin();
+       it != this->interfaces.end(); it++) {
 
-  while ((bytes = recvfrom(this->fd_socket, buff, sizeof(buff), 0,
-                           (struct sockaddr *)&from, &from_size)) > 0) {
+    if (it->fd != -1 && FD_ISSET(it->fd, fd_in)) {
 
-    buff[bytes] = '\0';
+      changed |= this->receive(it->fd);
+    }
+  }
+
+  if (this->fd_notify != -1 && FD_ISSET(this->fd_notify, fd_in)) {
+
+    changed |= this->receive(this->fd_notify);
+  }
+
+  if (changed) {
 
-    fprintf(Log::stream, "%s", buff);
-    fflush(Log::stream);
+    this->describe();
+
+    this->discovered();
+  }
+
+  if (this->churn != before) {
+
+    this->churned();
   }
-  fputc('\n', Log::stream);
-  fflush(Log::stream);
-}
\ No newline at end of file
+
+  this->plugs.save();
+}
@@ -13,11 +13,25 @@
 #include <cstring>
 #include <ctime>
 
+#include <algorithm>
+#include <charconv>
+#include <random>
 #include <string>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <strings.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
 #include "Log.h"
 #include "Plug.h"
+#include "Registry.h"
 
 class Discover {
 
@@ -25,28 +39,97 @@ public:
   Discover() { setup(); }
   ~Discover();
 
-  bool setup();
+  bool setup(const std::vector<std::string> &filter = {});
+  bool configure(const std::vector<std::string> &filter);
+  bool listen();
   bool discover();
-  void message();
 
-  std::vector<Plug> plugs;
+  int fds(fd_set *fd_in) const;
+  void message(const fd_set *fd_in);
+
+  bool scanning() const { return this->state; }
+  struct timeval *timeout(struct timeval *tv) const;
+  bool expire();
+
+  Registry plugs;
+
+  int fd_notify = -1;
 
-  int fd_socket;
+protected:
+  virtual void discovered() {}
+  virtual void churned() {}
+  virtual void describe(const Registry::Handle &) {}
+
+  void describe();
+
+  size_t churn = 0;
 
 private:
+  typedef struct {
+    std::string name;
+    struct in_addr addr;
+    int fd;
+    int port;
+  } Interface;
+
+  typedef struct {
+    bool notify;
+    std::string_view st;
+    std::string_view nts;
+    std::string_view usn;
+    std::string_view location;
+    std::string_view cache;
+    std::string_view bootid;
+    std::string_view configid;
+  } Message;
+
+  static const size_t BATCH = 16;
+
+  static const int BURSTS = 3;
+
+  static const char *TARGETS[];
+
   static const time_t mx = 3;
 
+  static const time_t max_age = 1800;
+
   static const int PORT = 1900;
 
   static const char *ADDRESS;
 
-  int port = 0;
+  std::vector<Discover::Interface> interfaces;
+
+  std::vector<std::string> filter;
 
   bool state = false;
 
+  size_t found = 0;
+
+  struct timeval started = {};
+  struct timeval next = {};
+  struct timeval deadline = {};
+
+  int bursts = 0;
+
+  std::unordered_set<std::string> seen;
+  std::unordered_set<std::string> expected;
+
+  std::minstd_rand rng{std::random_device{}()};
+
+  char buffs[Discover::BATCH][2048];
+
+  bool open(Discover::Interface &iface);
+  void shutdown();
   bool broadcast();
-  bool receive();
+  void schedule();
+  void respond(const Registry::Handle &plug, const std::string &key);
+  bool receive(int fd);
+  bool process(const Discover::Message &m);
+  bool refresh(const Registry::Handle &plug, const Discover::Message &m);
   void destroy();
+
+  static bool parse(std::string_view msg, Discover::Message &m);
+  static bool iequals(std::string_view a, std::string_view b);
 };
 
 #endif
@@ -0,0 +1,368 @@
+/**
+ *  @file   Events.cpp
+ *  @brief  Events Class Implementation
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#include "Events.h"
+
+Events::Events() {
+
+  if (-1 == (this->fd_epoll = epoll_create1(EPOLL_CLOEXEC))) {
+
+    Log::perror("Failed to create epoll instance");
+  }
+}
+
+Events::~Events() {
+
+  for (std::unordered_map<int, Events::Connection>::iterator it =
+           this->connections.begin();
+       it != this->connections.end(); it++) {
+
+    close(it->first);
+  }
+
+  if (this->fd_listen != -1) {
+
+    close(this->fd_listen);
+  }
+
+  if (this->fd_epoll != -1) {
+
+    close(this->fd_epoll);
+  }
+}
+
+bool Events::listen() {
+
+  if (this->fd_listen != -1) {
+
+    return true;
+  }
+
+  if (this->fd_epoll == -1) {
+
+    return false;
+  }
+
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+
+  struct epoll_event event;
+
+  const int yes = 1;
+
+  if (-1 == (this->fd_listen = socket(AF_INET,
+                                      SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                                      IPPROTO_TCP))) {
+
+    Log::perror("Failed to open TCP socket for events");
+
+    return false;
+  }
+
+  if (-1 == setsockopt(this->fd_listen, SOL_SOCKET, SO_REUSEADDR, &yes,
+                       sizeof(yes))) {
+
+    Log::perror("Failed to set socket reuse address");
+
+    goto FAIL;
+  }
+
+  addr.sin_family = AF_INET;
+  addr.sin_port = 0;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  memset(&addr.sin_zero, '\0', 8);
+
+  if (-1 == bind(this->fd_listen, (struct sockaddr *)&addr, sizeof(addr)) ||
+      -1 == ::listen(this->fd_listen, 64) ||
+      -1 == getsockname(this->fd_listen, (struct sockaddr *)&addr, &len)) {
+
+    Log::perror("Failed to listen for events");
+
+    goto FAIL;
+  }
+
+  event.events = EPOLLIN;
+  event.data.fd = this->fd_listen;
+  if (-1 ==
+      epoll_ctl(this->fd_epoll, EPOLL_CTL_ADD, this->fd_listen, &event)) {
+
+    Log::perror("Failed to add event listener to epoll");
+
+    goto FAIL;
+  }
+
+  this->port = ntohs(addr.sin_port);
+
+  Log::info("Receiving Plug events on port %d", this->port);
+
+  return true;
+
+FAIL:
+  close(this->fd_listen);
+  this->fd_listen = -1;
+  return false;
+}
+
+std::string Events::address(const std::string &ip) const {
+
+  struct sockaddr_in remote, local;
+  socklen_t len = sizeof(local);
+
+  char buff[INET_ADDRSTRLEN] = "";
+
+  // connecting a UDP socket sends nothing but picks the outgoing address
+  int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_UDP);
+  if (fd == -1) {
+
+    return "";
+  }
+
+  remote.sin_family = AF_INET;
+  remote.sin_port = htons(9);
+  memset(&remote.sin_zero, '\0', 8);
+
+  if (1 == inet_pton(AF_INET, ip.c_str(), &remote.sin_addr) &&
+      0 == connect(fd, (struct sockaddr *)&remote, sizeof(remote)) &&
+      0 == getsockname(fd, (struct sockaddr *)&local, &len)) {
+
+    inet_ntop(AF_INET, &local.sin_addr, buff, sizeof(buff));
+  }
+
+  close(fd);
+
+  return buff;
+}
+
+void Events::handler(Events::Callback callback) {
+
+  struct epoll_event events[64];
+
+  int n;
+  while ((n = epoll_wait(this->fd_epoll, events, 64, 0)) > 0) {
+
+    for (int i = 0; i < n; i++) {
+
+      if (events[i].data.fd == this->fd_listen) {
+
+        this->accept();
+      } else if (this->receive(events[i].data.fd, callback)) {
+
+        this->drop(events[i].data.fd);
+      }
+    }
+
+    if (n < 64) {
+
+      break;
+    }
+  }
+
+  if (n == -1 && errno != EINTR) {
+
+    Log::perror("Error while waiting for events");
+  }
+}
+
+void Events::accept() {
+
+  struct epoll_event event;
+
+  int fd;
+  while (-1 != (fd = accept4(this->fd_listen, NULL, NULL,
+                             SOCK_NONBLOCK | SOCK_CLOEXEC))) {
+
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (-1 == epoll_ctl(this->fd_epoll, EPOLL_CTL_ADD, fd, &event)) {
+
+      Log::perror("Failed to add event connection to epoll");
+
+      close(fd);
+
+      continue;
+    }
+
+    this->connections[fd] = {"", time(NULL) + Events::TIMEOUT};
+  }
+
+  if (errno != EAGAIN && errno != EWOULDBLOCK) {
+
+    Log::perror("Failed to accept event connection");
+  }
+}
+
+bool Events::receive(int fd, Events::Callback &callback) {
+
+  std::unordered_map<int, Events::Connection>::iterator it =
+      this->connections.find(fd);
+  if (it == this->connections.end()) {
+
+    return true;
+  }
+
+  std::string &request = it->second.buff;
+
+  char buff[2048];
+
+  ssize_t bytes;
+  while ((bytes = recv(fd, buff, sizeof(buff), 0)) > 0) {
+
+    request.append(buff, bytes);
+  }
+
+  if (bytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK) ||
+      request.size() > Events::MAX_REQUEST) {
+
+    return true;
+  }
+
+  std::string::size_type eoh = request.find("\r\n\r\n"), length = 0;
+  if (eoh == std::string::npos) {
+
+    return false;
+  }
+
+  std::string sid;
+
+  std::string::size_type b = 0, e;
+  while ((e = request.find("\r\n", b)) != std::string::npos && e < eoh) {
+
+    b = e + 2;
+
+    std::string line = request.substr(b, request.find("\r\n", b) - b);
+
+    if (0 == strncasecmp(line.c_str(), "Content-Length:", 15)) {
+
+      length = strtoul(line.c_str() + 15, NULL, 10);
+    } else if (0 == strncasecmp(line.c_str(), "SID:", 4)) {
+
+      std::string::size_type f = line.find_first_not_of(" \t", 4);
+      if (f != std::string::npos) {
+
+        sid = line.substr(f, line.find_last_not_of(" \t") + 1 - f);
+      }
+    }
+  }
+
+  if (request.size() < eoh + 4 + length) {
+
+    return false;
+  }
+
+  if (0 != request.compare(0, 7, "NOTIFY ") || sid.empty()) {
+
+    this->reply(fd, "400 Bad Request");
+
+    return true;
+  }
+
+  bool known = true;
+
+  Events::Propertyset properties;
+
+  properties.scan(std::string_view(request).substr(eoh + 4, length));
+
+  for (std::vector<std::pair<std::string, std::string>>::const_iterator it =
+           properties.values.begin();
+       it != properties.values.end(); it++) {
+
+    known &= callback(sid, it->first, it->second);
+  }
+
+  this->reply(fd, known ? "200 OK" : "412 Precondition Failed");
+
+  return true;
+}
+
+std::string *Events::Propertyset::open(std::string_view element) {
+
+  if (element == "property") {
+
+    this->property = true;
+
+    return nullptr;
+  }
+
+  if (!this->property) {
+
+    return nullptr;
+  }
+
+  this->property = false;
+
+  this->values.emplace_back(element, "");
+
+  return &this->values.back().second;
+}
+
+void Events::reply(int fd, const char *status) {
+
+  std::string msg = std::string("HTTP/1.1 ") + status +
+                    "\r\n"
+                    "Content-Length: 0\r\n"
+                    "Connection: close\r\n"
+                    "\r\n";
+
+  send(fd, msg.c_str(), msg.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+void Events::drop(int fd) {
+
+  epoll_ctl(this->fd_epoll, EPOLL_CTL_DEL, fd, NULL);
+
+  close(fd);
+
+  this->connections.erase(fd);
+}
+
+struct timeval *Events::timeout(struct timeval *tv) const {
+
+  if (this->connections.empty()) {
+
+    return nullptr;
+  }
+
+  time_t next = this->connections.begin()->second.deadline;
+
+  for (std::unordered_map<int, Events::Connection>::const_iterator it =
+           this->connections.begin();
+       it != this->connections.end(); it++) {
+
+    next = std::min(next, it->second.deadline);
+  }
+
+  tv->tv_sec = std::max(next - time(NULL), (time_t)0);
+
+  tv->tv_usec = 0;
+
+  return tv;
+}
+
+void Events::expire() {
+
+  time_t now = time(NULL);
+
+  std::vector<int> expired;
+
+  for (std::unordered_map<int, Events::Connection>::iterator it =
+           this->connections.begin();
+       it != this->connections.end(); it++) {
+
+    if (it->second.deadline <= now) {
+
+      expired.push_back(it->first);
+    }
+  }
+
+  for (std::vector<int>::iterator it = expired.begin(); it != expired.end();
+       it++) {
+
+    this->drop(*it);
+  }
+}
@@ -0,0 +1,89 @@
+/**
+ *  @file   Events.h
+ *  @brief  Events Class Definition
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#ifndef EVENTS_H_
+#define EVENTS_H_
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "Log.h"
+#include "Markup.h"
+
+class Events {
+
+public:
+  typedef std::function<bool(const std::string &sid, const std::string &name,
+                             const std::string &value)>
+      Callback;
+
+  Events();
+  ~Events();
+
+  bool listen();
+
+  void handler(Callback callback);
+  struct timeval *timeout(struct timeval *tv) const;
+  void expire();
+
+  std::string address(const std::string &ip) const;
+
+  int fd_epoll = -1;
+  int port = 0;
+
+private:
+  typedef struct {
+    std::string buff;
+    time_t deadline;
+  } Connection;
+
+  // the first child of every property is a variable and its value
+  class Propertyset : public Markup {
+
+  public:
+    std::vector<std::pair<std::string, std::string>> values;
+
+  protected:
+    std::string *open(std::string_view element) override;
+
+  private:
+    bool property = false;
+  };
+
+  static const time_t TIMEOUT = 5;
+
+  static const size_t MAX_REQUEST = 16384;
+
+  int fd_listen = -1;
+
+  std::unordered_map<int, Events::Connection> connections;
+
+  void accept();
+  bool receive(int fd, Callback &callback);
+  void reply(int fd, const char *status);
+  void drop(int fd);
+};
+
+#endif
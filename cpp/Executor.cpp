@@ -0,0 +1,154 @@
+/**
+ *  @file   Executor.cpp
+ *  @brief  Executor Class Implementation
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#include "Executor.h"
+
+void Executor::submit(const std::string &key, Executor::Task task) {
+
+  Executor::Job job = {std::move(task), {}, false};
+
+  gettimeofday(&job.queued, NULL);
+
+  std::deque<Executor::Job> &queue = this->queues[key];
+
+  queue.push_back(std::move(job));
+
+  if (queue.size() == 1) {
+
+    this->ready.push_back(key);
+  }
+
+  if (++this->queued > this->deepest) {
+
+    this->deepest = this->queued;
+  }
+
+  this->dispatch();
+}
+
+void Executor::dispatch() {
+
+  // tasks that finish synchronously re-enter through finish()
+  if (this->dispatching) {
+
+    return;
+  }
+
+  this->dispatching = true;
+
+  while (this->running < this->workers && !this->ready.empty()) {
+
+    std::string key = std::move(this->ready.front());
+
+    this->ready.pop_front();
+
+    Executor::Job &job = this->queues[key].front();
+
+    ++this->running;
+
+    if (job.resumed) {
+
+      --this->suspended;
+
+      job.resumed = false;
+
+      Executor::Task task = std::move(job.task);
+
+      task([this, key]() { this->finish(key); });
+
+      continue;
+    }
+
+    struct timeval now, wait;
+    gettimeofday(&now, NULL);
+
+    timersub(&now, &job.queued, &wait);
+
+    long ms = wait.tv_sec * 1000L + wait.tv_usec / 1000L;
+
+    this->waited += ms;
+
+    if (ms > this->longest) {
+
+      this->longest = ms;
+    }
+
+    ++this->started;
+
+    --this->queued;
+
+    Executor::Task task = std::move(job.task);
+
+    task([this, key]() { this->finish(key); });
+  }
+
+  this->dispatching = false;
+}
+
+void Executor::suspend(const std::string &key) {
+
+  if (this->queues.find(key) == this->queues.end()) {
+
+    return;
+  }
+
+  // the job stays at the head of its queue, so nothing queued behind it runs
+  ++this->suspended;
+
+  --this->running;
+
+  this->dispatch();
+}
+
+void Executor::resume(const std::string &key, Executor::Task task) {
+
+  std::unordered_map<std::string, std::deque<Executor::Job>>::iterator it =
+      this->queues.find(key);
+  if (it == this->queues.end()) {
+
+    return;
+  }
+
+  Executor::Job &job = it->second.front();
+
+  job.task = std::move(task);
+
+  job.resumed = true;
+
+  // work already underway is finished before new work is started
+  this->ready.push_front(key);
+
+  this->dispatch();
+}
+
+void Executor::finish(const std::string &key) {
+
+  std::unordered_map<std::string, std::deque<Executor::Job>>::iterator it =
+      this->queues.find(key);
+  if (it == this->queues.end()) {
+
+    return;
+  }
+
+  it->second.pop_front();
+
+  if (it->second.empty()) {
+
+    this->queues.erase(it);
+  } else {
+
+    this->ready.push_back(key);
+  }
+
+  --this->running;
+
+  ++this->done;
+
+  this->dispatch();
+}
@@ -0,0 +1,76 @@
+/**
+ *  @file   Executor.h
+ *  @brief  Executor Class Definition
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include <sys/time.h>
+
+class Executor {
+
+public:
+  typedef std::function<void()> Finished;
+  typedef std::function<void(Finished finished)> Task;
+
+  Executor(size_t workers = 32) : workers(workers) {}
+  ~Executor() = default;
+
+  void submit(const std::string &key, Task task);
+
+  // the running task of key gives up its worker, the key stays blocked
+  void suspend(const std::string &key);
+  void resume(const std::string &key, Task task);
+
+  size_t depth() const { return this->queued; }
+  size_t max_depth() const { return this->deepest; }
+  size_t busy() const { return this->running; }
+  unsigned long completed() const { return this->done; }
+  long wait_avg() const {
+    return this->started ? this->waited / (long)this->started : 0;
+  }
+  long wait_max() const { return this->longest; }
+
+private:
+  typedef struct {
+    Task task;
+    struct timeval queued;
+    bool resumed;
+  } Job;
+
+  size_t workers;
+
+  size_t running = 0;
+
+  size_t suspended = 0;
+
+  size_t queued = 0;
+  size_t deepest = 0;
+
+  unsigned long started = 0;
+  unsigned long done = 0;
+
+  long waited = 0;
+  long longest = 0;
+
+  bool dispatching = false;
+
+  std::unordered_map<std::string, std::deque<Executor::Job>> queues;
+
+  std::deque<std::string> ready;
+
+  void dispatch();
+  void finish(const std::string &key);
+};
+
+#endif
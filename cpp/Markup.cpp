@@ -0,0 +1,144 @@
+/**
+ *  @file   Markup.cpp
+ *  @brief  Markup Class Implementation
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#include "Markup.h"
+
+void Markup::scan(std::string_view chunk) {
+
+  for (char c : chunk) {
+
+    if (this->tag) {
+
+      if (c != '>') {
+
+        if (this->token.size() < Markup::MAX_TOKEN) {
+
+          this->token += c;
+        }
+
+        continue;
+      }
+
+      this->tag = false;
+
+      std::string_view element(this->token);
+
+      if (element.empty() || element[0] == '?' || element[0] == '!') {
+
+        continue;
+      }
+
+      if (element[0] == '/') {
+
+        this->end();
+      } else if (element.back() != '/') {
+
+        this->begin(element);
+      } else {
+
+        element.remove_suffix(1);
+
+        this->begin(element);
+
+        this->end();
+      }
+
+      continue;
+    }
+
+    if (c == '<') {
+
+      this->tag = true;
+
+      this->token.clear();
+    } else if (this->field && this->text.size() < Markup::MAX_TOKEN) {
+
+      this->text += c;
+    }
+  }
+}
+
+void Markup::clear() {
+
+  this->tag = false;
+
+  this->token.clear();
+
+  this->text.clear();
+
+  this->field = nullptr;
+}
+
+void Markup::begin(std::string_view element) {
+
+  element = element.substr(0, element.find_first_of(" \t\r\n"));
+
+  element.remove_prefix(element.find(':') + 1);
+
+  this->text.clear();
+
+  this->field = this->open(element);
+}
+
+void Markup::end() {
+
+  std::string *field = this->field;
+  if (!field) {
+
+    return;
+  }
+
+  Markup::unescape(this->text, field);
+
+  this->field = nullptr;
+
+  this->close(field);
+}
+
+void Markup::unescape(const std::string &text, std::string *s) {
+
+  static const struct {
+    const char *entity;
+    char c;
+  } entities[] = {{"&amp;", '&'},  {"&lt;", '<'},   {"&gt;", '>'},
+                  {"&quot;", '"'}, {"&apos;", '\''}};
+
+  s->clear();
+
+  size_t b = text.find_first_not_of(" \t\r\n");
+  size_t e = text.find_last_not_of(" \t\r\n");
+
+  for (size_t i = b; b != std::string::npos && i <= e; i++) {
+
+    bool matched = false;
+
+    if (text[i] == '&') {
+
+      for (size_t j = 0; j < sizeof(entities) / sizeof(*entities); j++) {
+
+        if (text.compare(i, strlen(entities[j].entity), entities[j].entity) ==
+            0) {
+
+          *s += entities[j].c;
+
+          i += strlen(entities[j].entity) - 1;
+
+          matched = true;
+
+          break;
+        }
+      }
+    }
+
+    if (!matched) {
+
+      *s += text[i];
+    }
+  }
+}
@@ -0,0 +1,48 @@
+/**
+ *  @file   Markup.h
+ *  @brief  Markup Class Definition
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#ifndef MARKUP_H_
+#define MARKUP_H_
+
+#include <cstring>
+
+#include <string>
+#include <string_view>
+
+class Markup {
+
+public:
+  Markup() = default;
+  virtual ~Markup() = default;
+
+  void scan(std::string_view chunk);
+  void clear();
+
+  static void unescape(const std::string &text, std::string *s);
+
+protected:
+  // called with the bare element name, returns where its text goes, if at all
+  virtual std::string *open(std::string_view element) = 0;
+  virtual void close(std::string *) {}
+
+private:
+  static const size_t MAX_TOKEN = 256;
+
+  bool tag = false;
+
+  std::string token;
+  std::string text;
+
+  std::string *field = nullptr;
+
+  void begin(std::string_view element);
+  void end();
+};
+
+#endif
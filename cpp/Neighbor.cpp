@@ -0,0 +1,122 @@
+/**
+ *  @file   Neighbor.cpp
+ *  @brief  Neighbor Class Implementation
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#include "Neighbor.h"
+
+bool Neighbor::open() {
+
+  if (this->fd != -1) {
+
+    return true;
+  }
+
+  struct sockaddr_nl addr;
+
+  if (-1 == (this->fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK,
+                               NETLINK_ROUTE))) {
+
+    Log::perror("Failed to open netlink socket");
+
+    return false;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = RTMGRP_NEIGH;
+
+  if (-1 == bind(this->fd, (struct sockaddr *)&addr, sizeof(addr))) {
+
+    Log::perror("Failed to subscribe to neighbor table changes");
+
+    goto FAIL;
+  }
+
+  Log::info("Monitoring neighbor table for Plug address changes");
+
+  return true;
+
+FAIL:
+  ::close(this->fd);
+  this->fd = -1;
+  return false;
+}
+
+void Neighbor::close() {
+
+  if (this->fd != -1) {
+
+    ::close(this->fd);
+
+    this->fd = -1;
+  }
+}
+
+void Neighbor::handler(Neighbor::Callback callback) {
+
+  ssize_t bytes;
+  while ((bytes = recv(this->fd, this->buff, sizeof(this->buff), 0)) > 0) {
+
+    for (struct nlmsghdr *nh = (struct nlmsghdr *)this->buff;
+         NLMSG_OK(nh, bytes); nh = NLMSG_NEXT(nh, bytes)) {
+
+      if (nh->nlmsg_type != RTM_NEWNEIGH && nh->nlmsg_type != RTM_DELNEIGH) {
+
+        continue;
+      }
+
+      struct ndmsg *nd = (struct ndmsg *)NLMSG_DATA(nh);
+
+      if (nd->ndm_family != AF_INET) {
+
+        continue;
+      }
+
+      const unsigned char *lladdr = nullptr;
+
+      const struct in_addr *dst = nullptr;
+
+      int len = RTM_PAYLOAD(nh);
+
+      for (struct rtattr *rta = RTM_RTA(nd); RTA_OK(rta, len);
+           rta = RTA_NEXT(rta, len)) {
+
+        if (rta->rta_type == NDA_DST && RTA_PAYLOAD(rta) == 4) {
+
+          dst = (const struct in_addr *)RTA_DATA(rta);
+        } else if (rta->rta_type == NDA_LLADDR && RTA_PAYLOAD(rta) == 6) {
+
+          lladdr = (const unsigned char *)RTA_DATA(rta);
+        }
+      }
+
+      if (!dst || !lladdr) {
+
+        continue;
+      }
+
+      bool present =
+          nh->nlmsg_type == RTM_NEWNEIGH &&
+          !(nd->ndm_state & (NUD_FAILED | NUD_INCOMPLETE | NUD_NOARP));
+
+      char mac[13], ip[INET_ADDRSTRLEN];
+
+      snprintf(mac, sizeof(mac), "%02X%02X%02X%02X%02X%02X", lladdr[0],
+               lladdr[1], lladdr[2], lladdr[3], lladdr[4], lladdr[5]);
+
+      inet_ntop(AF_INET, dst, ip, sizeof(ip));
+
+      callback(mac, ip, present);
+    }
+  }
+
+  if (bytes == -1 && !(errno == EAGAIN || errno == EWOULDBLOCK)) {
+
+    Log::perror("Error while receiving neighbor table change");
+  }
+}
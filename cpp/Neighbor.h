@@ -0,0 +1,51 @@
+/**
+ *  @file   Neighbor.h
+ *  @brief  Neighbor Class Definition
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#ifndef NEIGHBOR_H_
+#define NEIGHBOR_H_
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <functional>
+#include <string>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <linux/neighbour.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Log.h"
+
+class Neighbor {
+
+public:
+  typedef std::function<void(const std::string &mac, const std::string &ip,
+                             bool present)>
+      Callback;
+
+  Neighbor() = default;
+  ~Neighbor() { this->close(); }
+
+  bool open();
+  void close();
+
+  void handler(Callback callback);
+
+  int fd = -1;
+
+private:
+  char buff[8192];
+};
+
+#endif
@@ -8,211 +8,329 @@
  ***********************************************/
 
 #include "Plug.h"
+#include "Registry.h"
 
-Plug::Plug(std::string ip, int port) : ip(ip), port(port) {}
+Plug::Plug(std::string ip, int port) : ip(ip), port(port) {
 
-std::string Plug::Name(std::string name) {
+  SOAP::resolve(this->ip, this->port, &this->remote);
+}
 
-  if (this->lost) {
+void Plug::Name(SOAP &soap, std::string name, Plug::Done done) {
+
+  std::shared_ptr<Plug> self = shared_from_this();
+
+  this->Request(soap,
+                name.length() > 0 ? SOAP::SetFriendlyName
+                                  : SOAP::GetFriendlyName,
+                name, [self, done](bool ok, const std::string &value) {
+                  if (ok) {
+                    self->name = value;
+                  }
+                  if (done) {
+                    done(ok);
+                  }
+                });
+}
 
-    Log::warn("Plug lost at %s: using last known name '%s'", this->ip.c_str(),
-              this->name.c_str());
+void Plug::State(SOAP &soap, std::function<void(bool ok, bool on)> done) {
 
-    return this->name;
-  }
+  if (this->evented && this->state != -1) {
 
-  this->name = name.length() > 0 ? this->SOAPRequest("SetFriendlyName", name)
-                                 : this->SOAPRequest("GetFriendlyName");
-
-  return this->name;
-}
+    done(true, this->state == Plug::ON);
 
-bool Plug::isOn() { return this->State() == Plug::ON; }
+    return;
+  }
 
-bool Plug::isOff() { return this->State() == Plug::OFF; }
+  std::shared_ptr<Plug> self = shared_from_this();
 
-bool Plug::State() { return this->SOAPRequest("GetBinaryState") == "1"; }
+  this->Request(soap, SOAP::GetBinaryState, "",
+                [self, done](bool ok, const std::string &value) {
+                  int state = Plug::Binary(value);
+                  if (ok && state != -1) {
+                    self->state = state;
+                  }
+                  done(ok && state != -1, state == Plug::ON);
+                });
+}
 
-bool Plug::Toggle() {
+int Plug::Binary(const std::string &value) {
 
-  if (this->isOn()) {
+  // an Insight reports 8 when on but idle, so only 0 means off
+  if (value.empty() || !isdigit((unsigned char)value[0])) {
 
-    return this->Off() == Plug::OFF;
+    return -1;
   }
 
-  return this->On() == Plug::ON;
+  return value[0] == '0' ? Plug::OFF : Plug::ON;
 }
 
-bool Plug::On() {
+void Plug::Toggle(SOAP &soap, Plug::Done done) {
 
-  if (this->isOff()) {
+  std::shared_ptr<Plug> self = shared_from_this();
 
-    return this->SOAPRequest("SetBinaryState", "1") == "1";
-  }
+  SOAP *s = &soap;
 
-  return true;
+  this->State(soap, [self, s, done](bool ok, bool on) {
+    if (!ok) {
+      if (done) {
+        done(false);
+      }
+      return;
+    }
+    self->Switch(*s, on ? Plug::OFF : Plug::ON, done, false);
+  });
 }
 
-bool Plug::Off() {
+void Plug::On(SOAP &soap, Plug::Done done, unsigned long sequence) {
 
-  if (this->isOn()) {
+  this->Switch(soap, Plug::ON, done, true, sequence);
+}
 
-    return this->SOAPRequest("SetBinaryState", "0") == "0";
-  }
+void Plug::Off(SOAP &soap, Plug::Done done, unsigned long sequence) {
 
-  return true;
+  this->Switch(soap, Plug::OFF, done, true, sequence);
 }
 
-std::string Plug::SOAPRequest(std::string service, std::string arg) {
+void Plug::Switch(SOAP &soap, int state, Plug::Done done, bool check,
+                  unsigned long sequence) {
 
-  std::string param, response_tag;
+  std::shared_ptr<Plug> self = shared_from_this();
 
-  if (service == "GetFriendlyName") {
+  SOAP *s = &soap;
 
-    response_tag = "<FriendlyName>";
-  } else if (service == "SetFriendlyName") {
+  const std::string value = state == Plug::ON ? "1" : "0";
 
-    response_tag = "<FriendlyName>";
+  if (!check) {
 
-    param = response_tag + arg + "</FriendlyName>";
-  } else if (service == "GetBinaryState") {
+    this->Request(soap, SOAP::SetBinaryState, value,
+                  [self, state, done](bool ok, const std::string &reply) {
+                    ok = ok && Plug::Binary(reply) == state;
+                    if (ok) {
+                      self->state = state;
+                    }
+                    if (done) {
+                      done(ok);
+                    }
+                  });
 
-    response_tag = "<BinaryState>";
-  } else if (service == "SetBinaryState") {
+    return;
+  }
 
-    response_tag = "<BinaryState>";
+  this->State(soap, [self, s, state, done, sequence](bool ok, bool on) {
+    if (!ok || on == (state == Plug::ON)) {
+      if (done) {
+        done(ok);
+      }
+      return;
+    }
+    // a later command took over while the state was being read
+    if (sequence != 0 && sequence != self->sequence) {
+      if (done) {
+        done(false);
+      }
+      return;
+    }
+    self->Switch(*s, state, done, false);
+  });
+}
 
-    param = response_tag + arg + "</BinaryState>";
-  } else {
+void Plug::Move(const std::string &ip, int port) {
 
-    Log::err("Invalid SOAP request: %s", service.c_str());
+  this->ip = ip;
 
-    return "";
-  }
+  this->port = port;
 
-  std::string xml =
-      "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
-      "<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" "
-      "s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\">"
-      "<s:Body>"
-      "<u:" +
-      service + " xmlns:u=\"urn:Belkin:service:basicevent:1\">" + param +
-      "</u:" + service +
-      ">"
-      "</s:Body>"
-      "</s:Envelope>\r\n", msg, response;
+  SOAP::resolve(this->ip, this->port, &this->remote);
 
-  char buff[2048];
+  this->sid.clear();
 
-  const char *msg_p = NULL;
-  ssize_t sent = 0, bytes, s, e;
+  this->renew = 0;
 
-  struct sockaddr_in remote;
+  this->evented = false;
 
-  int fd_socket = -1, yes = 1;
-  if (-1 == (fd_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP))) {
+  // a new address deserves a fresh chance
+  this->breaker = Plug::CLOSED;
 
-    Log::perror("Failed to create TCP socket");
+  this->unreachable = 0;
 
-    goto FAIL;
-  }
+  this->cooldown = 0;
+}
 
-  remote.sin_family = AF_INET;
-  remote.sin_port = htons(this->port);
-  if (1 != inet_pton(remote.sin_family, this->ip.c_str(), &remote.sin_addr)) {
+void Plug::Failed() {
 
-    Log::perror("Failed to set socket address");
+  if (this->registry) {
 
-    goto FAIL;
+    this->registry->failed(shared_from_this());
   }
-  memset(&remote.sin_zero, '\0', 8);
+}
 
-  if (-1 ==
-      setsockopt(fd_socket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes))) {
+void Plug::Reachable() {
 
-    Log::perror("Failed to set socket reuse address");
+  this->unreachable = 0;
 
-    goto FAIL;
-  }
+  if (this->breaker != Plug::CLOSED) {
 
-  if (-1 ==
-      setsockopt(fd_socket, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes))) {
+    Log::info("Plug '%s' at %s answers again, resuming requests",
+              this->name.c_str(), this->ip.c_str());
 
-    Log::perror("Failed to set socket reuse port");
+    this->breaker = Plug::CLOSED;
 
-    goto FAIL;
+    this->cooldown = 0;
   }
+}
 
-  if (-1 ==
-      setsockopt(fd_socket, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes))) {
+void Plug::Unreachable() {
 
-    Log::perror("Failed to set TCP no-delay");
+  if (++this->unreachable >= Plug::TRIP && this->breaker == Plug::CLOSED) {
 
-    goto FAIL;
+    this->Trip();
   }
+}
 
-  if (-1 ==
-      connect(fd_socket, (struct sockaddr *)&remote, sizeof(struct sockaddr))) {
+void Plug::Trip() {
 
-    Log::perror("Failed to connect socket for SOAP request");
+  this->cooldown = this->cooldown == 0
+                       ? Plug::COOLDOWN_MIN
+                       : std::min(2 * this->cooldown, Plug::COOLDOWN_MAX);
 
-    goto FAIL;
-  }
+  this->reopen = time(NULL) + this->cooldown;
 
-  msg = "POST /upnp/control/basicevent1 HTTP/1.1\r\n"
-        "Host: " +
-        this->ip + ":" + std::to_string(ntohs(this->port)) +
-        "\r\n"
-        "User-Agent: WeMo-daemon/1.0\r\n"
-        "Content-Type: text/xml; charset=\"utf-8\"\r\n"
-        "Content-Length: " +
-        std::to_string(xml.size()) +
-        "\r\n"
-        "Accept: application/xml\r\n"
-        "SOAPAction: \"urn:Belkin:service:basicevent:1#" +
-        service +
-        "\"\r\n"
-        "Connection: close\r\n"
-        "\r\n" +
-        xml;
-
-  msg_p = msg.c_str();
-  bytes = msg.size();
-  while (bytes > 0) {
-
-    if ((sent = send(fd_socket, msg_p + sent, bytes, 0)) <= 0) {
-
-      Log::perror("Failed to send SOAP request");
-
-      goto FAIL;
-    }
+  if (this->breaker == Plug::CLOSED) {
 
-    bytes -= sent;
+    Log::warn("Plug '%s' at %s is unreachable, failing requests fast",
+              this->name.c_str(), this->ip.c_str());
   }
 
-  while ((bytes = recv(fd_socket, buff, sizeof(buff) - 1, 0)) > 0) {
-
-    buff[bytes] = '\0';
+  this->breaker = Plug::OPEN;
+}
 
-    response.append(buff, bytes);
+void Plug::Describe(SOAP &soap, Plug::Done done) {
+
+  std::shared_ptr<Plug> self = shared_from_this();
+
+  // the plug may move before the description arrives
+  const std::string ip = this->ip;
+
+  const int port = this->port;
+
+  this->describing = true;
+
+  bool queued = soap.http(
+      ip, port, "GET", this->location, "Accept: text/xml\r\n",
+      [self, ip, port, done](SOAP::Status status, int,
+                             const std::string &body) {
+        self->describing = false;
+        Description description;
+        if (status == SOAP::OK) {
+          description.scan(body);
+          if (!description.complete()) {
+            Log::err("Incomplete device description from %s:%d", ip.c_str(),
+                     port);
+          }
+        }
+        if (!description.complete()) {
+          if (status != SOAP::THROTTLED) {
+            self->Failed();
+          }
+          if (status == SOAP::TIMEOUT) {
+            ++self->timeouts;
+          }
+          if (done) {
+            done(false);
+          }
+          return;
+        }
+        if (self->udn.empty()) {
+          self->udn = description.udn;
+        }
+        self->type = description.type;
+        self->name = description.name;
+        self->model = description.model;
+        self->serial = description.serial;
+        self->firmware = description.firmware;
+        self->mac = description.mac;
+        self->described = true;
+        if (self->udn != description.udn) {
+          Log::warn("Plug at %s describes itself as %s", ip.c_str(),
+                    description.udn.c_str());
+        }
+        Log::info("Described Plug '%s' at %s:%d (%s, firmware %s)",
+                  description.name.c_str(), ip.c_str(), port,
+                  description.model.c_str(), description.firmware.c_str());
+        if (done) {
+          done(true);
+        }
+      });
+
+  if (!queued) {
+
+    this->describing = false;
+
+    this->Failed();
+
+    if (done) {
+
+      done(false);
+    }
   }
+}
 
-  if (bytes == -1) {
+void Plug::Request(SOAP &soap, const SOAP::Action &action,
+                   const std::string &arg, Plug::Reply reply) {
 
-    Log::perror("Error while receiving SOAP response");
+  // a device known to be dead is left alone until a probe finds it again
+  if (this->breaker != Plug::CLOSED) {
 
-    goto FAIL;
-  }
+    ++this->rejected;
 
-  close(fd_socket);
+    if (reply) {
 
-  s = response.find(response_tag);
-  e = response.find("</", s);
+      reply(false, "");
+    }
 
-  return response.substr(s + response_tag.length(),
-                         e - s - response_tag.length());
+    return;
+  }
 
-FAIL:
-  close(fd_socket);
-  return "";
+  std::shared_ptr<Plug> self = shared_from_this();
+
+  const struct sockaddr_in remote = this->remote;
+
+  bool queued = soap.request(
+      remote, action, arg,
+      [self, remote, reply](SOAP::Status status, int p,
+                            const std::string &value) {
+        bool ok = status == SOAP::OK;
+        if (ok && p != ntohs(remote.sin_port) && self->registry) {
+          bool here = self->remote.sin_addr.s_addr == remote.sin_addr.s_addr &&
+                      self->remote.sin_port == remote.sin_port;
+          const std::string ip = self->ip;
+          if (here) {
+            self->registry->move(self, ip, p);
+          }
+        }
+        if (status == SOAP::TIMEOUT) {
+          ++self->timeouts;
+        }
+        if (status == SOAP::TIMEOUT || status == SOAP::FAILED) {
+          self->Unreachable();
+        } else if (status != SOAP::THROTTLED) {
+          self->Reachable();
+        }
+        if (!ok && status != SOAP::THROTTLED) {
+          self->Failed();
+        }
+        if (reply) {
+          reply(ok, value);
+        }
+      });
+
+  if (!queued) {
+
+    this->Failed();
+
+    if (reply) {
+
+      reply(false, "");
+    }
+  }
 }
@@ -10,8 +10,13 @@
 #ifndef PLUG_H_
 #define PLUG_H_
 
+#include <cctype>
+#include <cerrno>
 #include <cstring>
+#include <ctime>
 
+#include <functional>
+#include <memory>
 #include <string>
 
 #include <arpa/inet.h>
@@ -21,34 +26,117 @@
 #include <netdb.h>
 #include <unistd.h>
 
+#include "Description.h"
 #include "Log.h"
+#include "SOAP.h"
 
-class Plug {
+class Registry;
+
+class Plug : public std::enable_shared_from_this<Plug> {
 
 public:
+  typedef std::function<void(bool ok)> Done;
+
+  enum Breaker { CLOSED, OPEN, HALF_OPEN };
+
   static const int OFF = 0;
   static const int ON = 1;
 
+  static const int PORT_FIRST = SOAP::PORT_FIRST;
+  static const int PORT_LAST = SOAP::PORT_LAST;
+
+  static const int TRIP = 3;
+
+  static const time_t COOLDOWN_MIN = 15;
+  static const time_t COOLDOWN_MAX = 300;
+
   Plug(std::string ip, int port);
 
-  std::string Name(std::string name = "");
+  void Name(SOAP &soap, std::string name = "", Plug::Done done = nullptr);
+
+  void State(SOAP &soap, std::function<void(bool ok, bool on)> done);
+  void Toggle(SOAP &soap, Plug::Done done = nullptr);
+
+  void On(SOAP &soap, Plug::Done done = nullptr, unsigned long sequence = 0);
+  void Off(SOAP &soap, Plug::Done done = nullptr, unsigned long sequence = 0);
+
+  void Move(const std::string &ip, int port);
 
-  bool isOn();
-  bool isOff();
-  bool State();
-  bool Toggle();
+  static int Binary(const std::string &value);
 
-  bool On();
-  bool Off();
+  void Describe(SOAP &soap, Plug::Done done = nullptr);
+
+  void Reachable();
+  void Unreachable();
+  void Trip();
 
   std::string ip;
   std::string name;
+  std::string udn;
+  std::string type;
+  std::string model;
+  std::string serial;
+  std::string firmware;
+  std::string mac;
+
+  std::string location = "/setup.xml";
+
+  long boot_id = -1;
+  long config_id = -1;
+
+  bool described = false;
+  bool describing = false;
+
+  bool named = false;
+
+  std::string sid;
+
+  time_t renew = 0;
+
+  int state = -1;
+
+  bool evented = false;
+
+  unsigned long sequence = 0;
 
   int port;
-  int lost = 0;
+
+  // resolved once per address, so requests skip parsing it
+  struct sockaddr_in remote = {};
+
+  time_t seen = 0;
+  time_t lease = 1800;
+  time_t expires = 0;
+
+  int missed = 0;
+
+  long latency = -1;
+
+  unsigned long timeouts = 0;
+
+  Plug::Breaker breaker = Plug::CLOSED;
+
+  int unreachable = 0;
+
+  time_t cooldown = 0;
+  time_t reopen = 0;
+
+  unsigned long rejected = 0;
+
+  bool stale = false;
+
+  Registry *registry = nullptr;
 
 private:
-  std::string SOAPRequest(std::string service, std::string arg = "");
+  typedef std::function<void(bool ok, const std::string &value)> Reply;
+
+  void Failed();
+
+  void Switch(SOAP &soap, int state, Plug::Done done, bool check = true,
+              unsigned long sequence = 0);
+
+  void Request(SOAP &soap, const SOAP::Action &action, const std::string &arg,
+               Plug::Reply reply);
 };
 
 #endif
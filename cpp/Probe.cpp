@@ -0,0 +1,265 @@
+/**
+ *  @file   Probe.cpp
+ *  @brief  Probe Class Implementation
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#include "Probe.h"
+
+Probe::Probe(size_t inflight, long timeout_ms)
+    : inflight(inflight), timeout_ms(timeout_ms) {
+
+  if (-1 == (this->fd_epoll = epoll_create1(EPOLL_CLOEXEC))) {
+
+    Log::perror("Failed to create epoll instance");
+  }
+}
+
+Probe::~Probe() {
+
+  for (std::unordered_map<int, Probe::Target>::iterator it =
+           this->pending.begin();
+       it != this->pending.end(); it++) {
+
+    close(it->first);
+  }
+
+  if (this->fd_epoll != -1) {
+
+    close(this->fd_epoll);
+  }
+}
+
+bool Probe::add(const std::string &ip, int port, Callback callback) {
+
+  if (this->fd_epoll == -1) {
+
+    return false;
+  }
+
+  this->queue.push_back((Probe::Target){
+      .ip = ip, .port = port, .callback = callback, .deadline = {}});
+
+  this->start();
+
+  return true;
+}
+
+void Probe::start() {
+
+  while (!this->queue.empty() && this->pending.size() < this->inflight) {
+
+    Probe::Target target = std::move(this->queue.front());
+
+    this->queue.pop_front();
+
+    struct sockaddr_in remote;
+
+    struct epoll_event event;
+
+    int fd;
+    if (-1 == (fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                           IPPROTO_TCP))) {
+
+      Log::perror("Failed to create TCP socket for probe");
+
+      this->done.emplace_back(std::move(target), false);
+
+      continue;
+    }
+
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(target.port);
+    if (1 != inet_pton(AF_INET, target.ip.c_str(), &remote.sin_addr)) {
+
+      Log::err("Invalid probe address %s", target.ip.c_str());
+
+      close(fd);
+
+      this->done.emplace_back(std::move(target), false);
+
+      continue;
+    }
+    memset(&remote.sin_zero, '\0', 8);
+
+    if (0 == connect(fd, (struct sockaddr *)&remote, sizeof(remote))) {
+
+      close(fd);
+
+      this->done.emplace_back(std::move(target), true);
+
+      continue;
+    }
+
+    if (errno != EINPROGRESS) {
+
+      close(fd);
+
+      this->done.emplace_back(std::move(target), false);
+
+      continue;
+    }
+
+    event.events = EPOLLOUT;
+    event.data.fd = fd;
+    if (-1 == epoll_ctl(this->fd_epoll, EPOLL_CTL_ADD, fd, &event)) {
+
+      Log::perror("Failed to add probe to epoll");
+
+      close(fd);
+
+      this->done.emplace_back(std::move(target), false);
+
+      continue;
+    }
+
+    gettimeofday(&target.deadline, NULL);
+
+    struct timeval offset = {this->timeout_ms / 1000,
+                             (this->timeout_ms % 1000) * 1000};
+
+    timeradd(&target.deadline, &offset, &target.deadline);
+
+    this->pending.emplace(fd, std::move(target));
+  }
+}
+
+void Probe::finish(int fd, bool alive) {
+
+  std::unordered_map<int, Probe::Target>::iterator it = this->pending.find(fd);
+  if (it == this->pending.end()) {
+
+    return;
+  }
+
+  Probe::Target target = std::move(it->second);
+
+  this->pending.erase(it);
+
+  epoll_ctl(this->fd_epoll, EPOLL_CTL_DEL, fd, NULL);
+
+  close(fd);
+
+  target.callback(target.ip, target.port, alive);
+}
+
+void Probe::deliver() {
+
+  while (!this->done.empty()) {
+
+    std::pair<Probe::Target, bool> result = std::move(this->done.front());
+
+    this->done.pop_front();
+
+    result.first.callback(result.first.ip, result.first.port, result.second);
+  }
+}
+
+void Probe::handler() {
+
+  this->deliver();
+
+  struct epoll_event events[64];
+
+  int n;
+  while ((n = epoll_wait(this->fd_epoll, events, 64, 0)) > 0) {
+
+    for (int i = 0; i < n; i++) {
+
+      int error = 0;
+      socklen_t len = sizeof(error);
+
+      if (-1 == getsockopt(events[i].data.fd, SOL_SOCKET, SO_ERROR, &error,
+                           &len)) {
+
+        error = errno;
+      }
+
+      this->finish(events[i].data.fd, error == 0);
+    }
+
+    if (n < 64) {
+
+      break;
+    }
+  }
+
+  if (n == -1 && errno != EINTR) {
+
+    Log::perror("Error while waiting for probes");
+  }
+
+  this->start();
+
+  this->deliver();
+}
+
+struct timeval *Probe::timeout(struct timeval *tv) const {
+
+  if (!this->done.empty()) {
+
+    timerclear(tv);
+
+    return tv;
+  }
+
+  if (this->pending.empty()) {
+
+    return nullptr;
+  }
+
+  struct timeval now, next = this->pending.begin()->second.deadline;
+
+  for (std::unordered_map<int, Probe::Target>::const_iterator it =
+           this->pending.begin();
+       it != this->pending.end(); it++) {
+
+    if (timercmp(&it->second.deadline, &next, <)) {
+
+      next = it->second.deadline;
+    }
+  }
+
+  gettimeofday(&now, NULL);
+
+  if (timercmp(&now, &next, >=)) {
+
+    timerclear(tv);
+  } else {
+
+    timersub(&next, &now, tv);
+  }
+
+  return tv;
+}
+
+void Probe::expire() {
+
+  struct timeval now;
+  gettimeofday(&now, NULL);
+
+  std::vector<int> expired;
+
+  for (std::unordered_map<int, Probe::Target>::iterator it =
+           this->pending.begin();
+       it != this->pending.end(); it++) {
+
+    if (timercmp(&now, &it->second.deadline, >=)) {
+
+      expired.push_back(it->first);
+    }
+  }
+
+  for (std::vector<int>::iterator it = expired.begin(); it != expired.end();
+       it++) {
+
+    this->finish(*it, false);
+  }
+
+  this->start();
+
+  this->deliver();
+}
@@ -0,0 +1,76 @@
+/**
+ *  @file   Probe.h
+ *  @brief  Probe Class Definition
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#ifndef PROBE_H_
+#define PROBE_H_
+
+#include <cerrno>
+#include <cstring>
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "Log.h"
+
+class Probe {
+
+public:
+  typedef std::function<void(const std::string &ip, int port, bool alive)>
+      Callback;
+
+  Probe(size_t inflight = 256, long timeout_ms = 1000);
+  ~Probe();
+
+  bool add(const std::string &ip, int port, Callback callback);
+
+  void handler();
+  struct timeval *timeout(struct timeval *tv) const;
+  void expire();
+
+  bool busy() const {
+    return !this->queue.empty() || !this->pending.empty() || !this->done.empty();
+  }
+
+  int fd_epoll;
+
+private:
+  typedef struct {
+    std::string ip;
+    int port;
+    Callback callback;
+    struct timeval deadline;
+  } Target;
+
+  size_t inflight;
+
+  long timeout_ms;
+
+  std::deque<Probe::Target> queue;
+
+  std::unordered_map<int, Probe::Target> pending;
+
+  std::deque<std::pair<Probe::Target, bool>> done;
+
+  void start();
+  void finish(int fd, bool alive);
+  void deliver();
+};
+
+#endif
@@ -0,0 +1,329 @@
+/**
+ *  @file   Registry.cpp
+ *  @brief  Registry Class Implementation
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#include "Registry.h"
+
+const char *Registry::store_file = "plugs.store";
+
+Registry::Handle Registry::add(const std::string &udn, const std::string &ip,
+                               int port) {
+
+  Handle &plug = this->udns[Registry::key(udn, ip)];
+
+  if (plug) {
+
+    this->move(plug, ip, port);
+
+    return plug;
+  }
+
+  plug = std::make_shared<Plug>(ip, port);
+
+  plug->udn = udn;
+
+  plug->registry = this;
+
+  this->ips[ip] = plug;
+
+  this->dirty = true;
+
+  return plug;
+}
+
+Registry::Handle Registry::find(const std::string &udn) const {
+
+  const_iterator it = this->udns.find(udn);
+
+  return it != this->udns.end() ? it->second : nullptr;
+}
+
+Registry::Handle Registry::find_ip(const std::string &ip) const {
+
+  const_iterator it = this->ips.find(ip);
+
+  return it != this->ips.end() ? it->second : nullptr;
+}
+
+Registry::Handle Registry::find_mac(const std::string &mac) const {
+
+  for (const_iterator it = this->udns.begin(); it != this->udns.end(); it++) {
+
+    const std::string &other = it->second->mac;
+
+    size_t i = 0, j = 0;
+
+    while (i < mac.size() && j < other.size()) {
+
+      if (!isxdigit(other[j])) {
+
+        j++;
+      } else if (toupper(mac[i]) == toupper(other[j])) {
+
+        i++;
+
+        j++;
+      } else {
+
+        break;
+      }
+    }
+
+    if (i == mac.size() && j == other.size()) {
+
+      return it->second;
+    }
+  }
+
+  return nullptr;
+}
+
+Registry::Handle Registry::find_name(const std::string &name) const {
+
+  for (const_iterator it = this->udns.begin(); it != this->udns.end(); it++) {
+
+    if (it->second->name == name) {
+
+      return it->second;
+    }
+  }
+
+  return nullptr;
+}
+
+bool Registry::move(const Handle &plug, const std::string &ip, int port) {
+
+  if (plug->ip == ip && plug->port == port) {
+
+    return false;
+  }
+
+  Log::info("Plug moved from %s:%d to %s:%d", plug->ip.c_str(), plug->port,
+            ip.c_str(), port);
+
+  iterator it = this->ips.find(plug->ip);
+  if (it != this->ips.end() && it->second == plug) {
+
+    this->ips.erase(it);
+  }
+
+  plug->Move(ip, port);
+
+  this->ips[ip] = plug;
+
+  this->dirty = true;
+
+  return true;
+}
+
+bool Registry::erase(const std::string &udn) {
+
+  iterator it = this->udns.find(udn);
+  if (it == this->udns.end()) {
+
+    return false;
+  }
+
+  this->erase(it);
+
+  return true;
+}
+
+bool Registry::erase(const Handle &plug) {
+
+  // the key a plug was added under goes stale once it learns its UDN or moves
+  iterator it = this->udns.find(Registry::key(plug->udn, plug->ip));
+  if (it == this->udns.end() || it->second != plug) {
+
+    for (it = this->udns.begin(); it != this->udns.end(); it++) {
+
+      if (it->second == plug) {
+
+        break;
+      }
+    }
+  }
+
+  if (it == this->udns.end()) {
+
+    return false;
+  }
+
+  this->erase(it);
+
+  return true;
+}
+
+Registry::iterator Registry::erase(iterator it) {
+
+  iterator ip = this->ips.find(it->second->ip);
+  if (ip != this->ips.end() && ip->second == it->second) {
+
+    this->ips.erase(ip);
+  }
+
+  it->second->registry = nullptr;
+
+  this->dirty = true;
+
+  return this->udns.erase(it);
+}
+
+size_t Registry::load() {
+
+  int fd = open(store_file, O_RDONLY);
+  if (fd == -1) {
+
+    return 0;
+  }
+
+  Registry::Header header;
+  Registry::Record record;
+
+  time_t now = time(NULL);
+
+  size_t n = 0;
+
+  if (read(fd, &header, sizeof(header)) != sizeof(header) ||
+      memcmp(header.magic, "WeMo", 4) != 0 ||
+      header.version != Registry::store_version) {
+
+    Log::warn("Ignoring incompatible Plug store '%s'", store_file);
+
+    close(fd);
+
+    return 0;
+  }
+
+  for (uint32_t i = 0; i < header.count; i++) {
+
+    if (read(fd, &record, sizeof(record)) != sizeof(record)) {
+
+      Log::warn("Truncated Plug store '%s'", store_file);
+
+      break;
+    }
+
+    record.udn[sizeof(record.udn) - 1] = '\0';
+    record.ip[sizeof(record.ip) - 1] = '\0';
+    record.name[sizeof(record.name) - 1] = '\0';
+    record.model[sizeof(record.model) - 1] = '\0';
+    record.serial[sizeof(record.serial) - 1] = '\0';
+    record.firmware[sizeof(record.firmware) - 1] = '\0';
+    record.mac[sizeof(record.mac) - 1] = '\0';
+    record.location[sizeof(record.location) - 1] = '\0';
+
+    if (record.expires <= now) {
+
+      continue;
+    }
+
+    Handle plug = this->add(record.udn, record.ip, record.port);
+
+    plug->name = record.name;
+    plug->model = record.model;
+
+    plug->serial = record.serial;
+
+    plug->firmware = record.firmware;
+
+    plug->mac = record.mac;
+
+    if (record.location[0] == '/') {
+
+      plug->location = record.location;
+    }
+
+    plug->boot_id = record.boot_id;
+
+    plug->config_id = record.config_id;
+
+    plug->described = record.model[0] != '\0';
+
+    plug->seen = record.seen;
+
+    plug->expires = record.expires;
+
+    plug->stale = true;
+
+    ++n;
+  }
+
+  close(fd);
+
+  this->dirty = false;
+
+  Log::info("Restored %zu Plug(s) from '%s'", n, store_file);
+
+  return n;
+}
+
+bool Registry::save(bool force) {
+
+  if (!this->dirty && !force) {
+
+    return true;
+  }
+
+  std::string tmp = std::string(store_file) + ".tmp";
+
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) {
+
+    Log::perror("Failed to write Plug store");
+
+    return false;
+  }
+
+  Registry::Header header = {{'W', 'e', 'M', 'o'},
+                             Registry::store_version,
+                             (uint32_t)this->udns.size()};
+
+  bool ok = write(fd, &header, sizeof(header)) == sizeof(header);
+
+  for (const_iterator it = this->udns.begin(); ok && it != this->udns.end();
+       it++) {
+
+    Registry::Record record = {};
+
+    strncpy(record.udn, it->second->udn.c_str(), sizeof(record.udn) - 1);
+    strncpy(record.ip, it->second->ip.c_str(), sizeof(record.ip) - 1);
+    strncpy(record.name, it->second->name.c_str(), sizeof(record.name) - 1);
+    strncpy(record.model, it->second->model.c_str(), sizeof(record.model) - 1);
+    strncpy(record.serial, it->second->serial.c_str(),
+            sizeof(record.serial) - 1);
+    strncpy(record.firmware, it->second->firmware.c_str(),
+            sizeof(record.firmware) - 1);
+    strncpy(record.mac, it->second->mac.c_str(), sizeof(record.mac) - 1);
+    strncpy(record.location, it->second->location.c_str(),
+            sizeof(record.location) - 1);
+
+    record.port = it->second->port;
+    record.boot_id = it->second->boot_id;
+    record.config_id = it->second->config_id;
+    record.seen = it->second->seen;
+    record.expires = it->second->expires;
+
+    ok = write(fd, &record, sizeof(record)) == sizeof(record);
+  }
+
+  close(fd);
+
+  if (!ok || -1 == rename(tmp.c_str(), store_file)) {
+
+    Log::perror("Failed to write Plug store");
+
+    unlink(tmp.c_str());
+
+    return false;
+  }
+
+  this->dirty = false;
+
+  return true;
+}
@@ -0,0 +1,113 @@
+/**
+ *  @file   Registry.h
+ *  @brief  Registry Class Definition
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#ifndef REGISTRY_H_
+#define REGISTRY_H_
+
+#include <cstdint>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Log.h"
+#include "Plug.h"
+
+class Registry {
+
+public:
+  typedef std::shared_ptr<Plug> Handle;
+  typedef std::function<void(const Handle &plug)> Failure;
+  typedef std::unordered_map<std::string, Handle>::iterator iterator;
+  typedef std::unordered_map<std::string, Handle>::const_iterator
+      const_iterator;
+
+  Registry() = default;
+  ~Registry() = default;
+
+  Handle add(const std::string &udn, const std::string &ip, int port);
+  Handle find(const std::string &udn) const;
+  Handle find_ip(const std::string &ip) const;
+  Handle find_mac(const std::string &mac) const;
+  Handle find_name(const std::string &name) const;
+
+  bool move(const Handle &plug, const std::string &ip, int port);
+
+  bool erase(const std::string &udn);
+  bool erase(const Handle &plug);
+  iterator erase(iterator it);
+
+  void touch() { this->dirty = true; }
+
+  // plugs report failed requests here, so they are acted on right away
+  void on_failure(Registry::Failure failure) {
+    this->failure = std::move(failure);
+  }
+  void failed(const Handle &plug) const {
+    if (this->failure) {
+      this->failure(plug);
+    }
+  }
+
+  size_t load();
+  bool save(bool force = false);
+
+  iterator begin() { return this->udns.begin(); }
+  iterator end() { return this->udns.end(); }
+  const_iterator begin() const { return this->udns.begin(); }
+  const_iterator end() const { return this->udns.end(); }
+
+  size_t size() const { return this->udns.size(); }
+  bool empty() const { return this->udns.empty(); }
+
+private:
+  std::unordered_map<std::string, Handle> udns;
+  std::unordered_map<std::string, Handle> ips;
+
+  bool dirty = false;
+
+  Registry::Failure failure;
+
+  static const char *store_file;
+
+  static const uint32_t store_version = 2;
+
+  typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+  } Header;
+
+  typedef struct {
+    char udn[64];
+    char ip[16];
+    char name[64];
+    char model[32];
+    char serial[32];
+    char firmware[64];
+    char mac[16];
+    char location[64];
+    int32_t port;
+    int64_t boot_id;
+    int64_t config_id;
+    int64_t seen;
+    int64_t expires;
+  } Record;
+
+  static const std::string &key(const std::string &udn, const std::string &ip) {
+    return udn.empty() ? ip : udn;
+  }
+};
+
+#endif
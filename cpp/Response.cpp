@@ -0,0 +1,196 @@
+/**
+ *  @file   Response.cpp
+ *  @brief  Response Class Implementation
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#include "Response.h"
+
+void Response::reset(const char *element, bool capture) {
+
+  // cleared in place, so a reused response keeps the capacity of its strings
+  this->clear();
+
+  this->status = 0;
+
+  this->headers.clear();
+
+  this->value.clear();
+
+  this->found = false;
+
+  this->content.clear();
+
+  this->fault = false;
+
+  this->code.clear();
+
+  this->description.clear();
+
+  this->state = Response::HEAD;
+
+  this->element = element;
+
+  this->capture = capture;
+
+  this->alive = false;
+
+  this->length = std::string::npos;
+
+  this->received = 0;
+}
+
+void Response::feed(std::string_view chunk) {
+
+  if (this->state == Response::HEAD) {
+
+    size_t from = this->headers.size() > 3 ? this->headers.size() - 3 : 0;
+
+    this->headers.append(chunk);
+
+    size_t eoh = this->headers.find("\r\n\r\n", from);
+    if (eoh == std::string::npos) {
+
+      if (this->headers.size() > Response::MAX_HEAD) {
+
+        this->state = Response::ERROR;
+      }
+
+      return;
+    }
+
+    chunk.remove_prefix(chunk.size() - (this->headers.size() - eoh - 4));
+
+    this->headers.resize(eoh + 2);
+
+    this->head();
+  }
+
+  if (this->state != Response::BODY) {
+
+    return;
+  }
+
+  size_t n = chunk.size();
+
+  if (this->length != std::string::npos &&
+      n > this->length - this->received) {
+
+    n = this->length - this->received;
+
+    // whatever follows the body cannot be trusted on a reused connection
+    this->alive = false;
+  }
+
+  if (this->capture) {
+
+    if (this->content.size() + n > Response::MAX_CONTENT) {
+
+      this->state = Response::ERROR;
+
+      return;
+    }
+
+    this->content.append(chunk.substr(0, n));
+  }
+
+  this->scan(chunk.substr(0, n));
+
+  this->received += n;
+
+  if (this->received == this->length) {
+
+    this->state = Response::DONE;
+  }
+}
+
+bool Response::eof() {
+
+  if (this->state == Response::BODY && this->length == std::string::npos) {
+
+    this->state = Response::DONE;
+  }
+
+  return this->complete();
+}
+
+void Response::head() {
+
+  const char *line = this->headers.c_str();
+
+  if (0 != strncmp(line, "HTTP/1.", 7) || strlen(line) < 12) {
+
+    this->state = Response::ERROR;
+
+    return;
+  }
+
+  this->alive = line[7] == '1';
+
+  this->status = atoi(line + 9);
+
+  const char *eol;
+  while ((eol = strstr(line, "\r\n")) != NULL && eol[2] != '\0') {
+
+    line = eol + 2;
+
+    if (0 == strncasecmp(line, "Content-Length:", 15)) {
+
+      this->length = strtoul(line + 15, NULL, 10);
+    } else if (0 == strncasecmp(line, "Connection:", 11)) {
+
+      std::string value(line + 11, strstr(line, "\r\n") - line - 11);
+
+      if (NULL != strcasestr(value.c_str(), "close")) {
+
+        this->alive = false;
+      } else if (NULL != strcasestr(value.c_str(), "keep-alive")) {
+
+        this->alive = true;
+      }
+    } else if (0 == strncasecmp(line, "Transfer-Encoding:", 18)) {
+
+      // not framed by length, so read up to the close of the connection
+      this->length = std::string::npos;
+
+      this->alive = false;
+    }
+  }
+
+  if (this->length == std::string::npos) {
+
+    this->alive = false;
+  }
+
+  this->state = this->length == 0 ? Response::DONE : Response::BODY;
+}
+
+std::string *Response::open(std::string_view element) {
+
+  if (*this->element != '\0' && element == this->element) {
+
+    return &this->value;
+  } else if (element == "Fault") {
+
+    this->fault = true;
+  } else if (element == "faultstring" || element == "errorDescription") {
+
+    return &this->description;
+  } else if (element == "errorCode") {
+
+    return &this->code;
+  }
+
+  return nullptr;
+}
+
+void Response::close(std::string *field) {
+
+  if (field == &this->value) {
+
+    this->found = true;
+  }
+}
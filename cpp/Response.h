@@ -0,0 +1,78 @@
+/**
+ *  @file   Response.h
+ *  @brief  Response Class Definition
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#ifndef RESPONSE_H_
+#define RESPONSE_H_
+
+#include <cstdlib>
+#include <cstring>
+
+#include <string>
+#include <string_view>
+
+#include <strings.h>
+
+#include "Markup.h"
+
+class Response : public Markup {
+
+public:
+  Response() = default;
+  ~Response() = default;
+
+  void reset(const char *element, bool capture = false);
+
+  void feed(std::string_view chunk);
+  bool eof();
+
+  bool ready() const {
+    return this->complete() || (this->found && this->status == 200);
+  }
+  bool complete() const { return this->state == Response::DONE; }
+  bool failed() const { return this->state == Response::ERROR; }
+  bool keep() const { return this->alive && this->complete(); }
+
+  int status = 0;
+
+  std::string headers;
+
+  std::string value;
+  bool found = false;
+
+  std::string content;
+
+  bool fault = false;
+  std::string code;
+  std::string description;
+
+private:
+  enum State { HEAD, BODY, DONE, ERROR };
+
+  static const size_t MAX_HEAD = 8192;
+  static const size_t MAX_CONTENT = 65536;
+
+  Response::State state = Response::HEAD;
+
+  const char *element = "";
+
+  bool capture = false;
+
+  bool alive = false;
+
+  size_t length = std::string::npos;
+  size_t received = 0;
+
+  void head();
+
+protected:
+  std::string *open(std::string_view element) override;
+  void close(std::string *field) override;
+};
+
+#endif
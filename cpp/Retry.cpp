@@ -0,0 +1,144 @@
+/**
+ *  @file   Retry.cpp
+ *  @brief  Retry Class Implementation
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#include "Retry.h"
+
+void Retry::policy(int attempts, long backoff_ms, long max_backoff_ms,
+                   time_t expiry) {
+
+  this->attempts = attempts;
+
+  this->backoff_ms = backoff_ms;
+
+  this->max_backoff_ms = std::max(max_backoff_ms, backoff_ms);
+
+  this->expiry = expiry;
+}
+
+long Retry::delay(int attempt) {
+
+  long ms = this->backoff_ms;
+
+  for (int i = 1; i < attempt && ms < this->max_backoff_ms; i++) {
+
+    ms *= 2;
+  }
+
+  ms = std::min(ms, this->max_backoff_ms);
+
+  // half fixed, half jitter, so plugs failing together spread out
+  std::uniform_int_distribution<long> jitter(0, ms / 2);
+
+  return ms / 2 + jitter(this->rng);
+}
+
+bool Retry::allowed(int attempt, long delay_ms, time_t scheduled) const {
+
+  if (attempt >= this->attempts) {
+
+    return false;
+  }
+
+  struct timeval now, wait = {delay_ms / 1000, (delay_ms % 1000) * 1000}, next;
+
+  gettimeofday(&now, NULL);
+
+  timeradd(&now, &wait, &next);
+
+  return next.tv_sec < scheduled + this->expiry;
+}
+
+void Retry::after(const std::string &key, long delay_ms,
+                  Retry::Attempt attempt) {
+
+  Retry::Pending p = {key, {}, std::move(attempt)};
+
+  struct timeval now, wait = {delay_ms / 1000, (delay_ms % 1000) * 1000};
+
+  gettimeofday(&now, NULL);
+
+  timeradd(&now, &wait, &p.when);
+
+  this->pending.push_back(std::move(p));
+
+  ++this->retried;
+}
+
+void Retry::wake(const std::string &key) {
+
+  for (std::vector<Retry::Pending>::iterator it = this->pending.begin();
+       it != this->pending.end(); it++) {
+
+    if (it->key == key) {
+
+      timerclear(&it->when);
+    }
+  }
+}
+
+struct timeval *Retry::timeout(struct timeval *tv) const {
+
+  if (this->pending.empty()) {
+
+    return nullptr;
+  }
+
+  struct timeval now, next = this->pending.front().when;
+
+  for (std::vector<Retry::Pending>::const_iterator it = this->pending.begin();
+       it != this->pending.end(); it++) {
+
+    if (timercmp(&it->when, &next, <)) {
+
+      next = it->when;
+    }
+  }
+
+  gettimeofday(&now, NULL);
+
+  if (timercmp(&next, &now, <)) {
+
+    timerclear(tv);
+  } else {
+
+    timersub(&next, &now, tv);
+  }
+
+  return tv;
+}
+
+void Retry::expire() {
+
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+
+  std::vector<Retry::Attempt> due;
+
+  for (std::vector<Retry::Pending>::iterator it = this->pending.begin();
+       it != this->pending.end();) {
+
+    if (!timercmp(&now, &it->when, <)) {
+
+      due.push_back(std::move(it->attempt));
+
+      it = this->pending.erase(it);
+    } else {
+
+      it++;
+    }
+  }
+
+  // attempts may schedule their own retry, so run them only after the sweep
+  for (std::vector<Retry::Attempt>::iterator it = due.begin(); it != due.end();
+       it++) {
+
+    (*it)();
+  }
+}
@@ -0,0 +1,68 @@
+/**
+ *  @file   Retry.h
+ *  @brief  Retry Class Definition
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#ifndef RETRY_H_
+#define RETRY_H_
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/time.h>
+
+class Retry {
+
+public:
+  typedef std::function<void()> Attempt;
+
+  Retry(int attempts = 5, long backoff_ms = 1000, long max_backoff_ms = 60000,
+        time_t expiry = 600)
+      : attempts(attempts), backoff_ms(backoff_ms),
+        max_backoff_ms(max_backoff_ms), expiry(expiry) {}
+  ~Retry() = default;
+
+  void policy(int attempts, long backoff_ms, long max_backoff_ms,
+              time_t expiry);
+
+  long delay(int attempt);
+  bool allowed(int attempt, long delay_ms, time_t scheduled) const;
+  void after(const std::string &key, long delay_ms, Retry::Attempt attempt);
+  void wake(const std::string &key);
+
+  struct timeval *timeout(struct timeval *tv) const;
+  void expire();
+
+  size_t waiting() const { return this->pending.size(); }
+
+  int max_attempts() const { return this->attempts; }
+
+  unsigned long retried = 0;
+
+private:
+  typedef struct {
+    std::string key;
+    struct timeval when;
+    Retry::Attempt attempt;
+  } Pending;
+
+  int attempts;
+
+  long backoff_ms;
+  long max_backoff_ms;
+
+  time_t expiry;
+
+  std::vector<Retry::Pending> pending;
+
+  std::minstd_rand rng{std::random_device{}()};
+};
+
+#endif
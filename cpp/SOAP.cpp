@@ -0,0 +1,1118 @@
+/**
+ *  @file   SOAP.cpp
+ *  @brief  SOAP Class Implementation
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#include "SOAP.h"
+
+SOAP::SOAP(size_t inflight, long timeout_ms)
+    : inflight(inflight), timeout_ms(timeout_ms), connect_ms(timeout_ms) {
+
+  if (-1 == (this->fd_epoll = epoll_create1(EPOLL_CLOEXEC))) {
+
+    Log::perror("Failed to create epoll instance");
+  }
+}
+
+SOAP::~SOAP() {
+
+  for (std::list<SOAP::Request>::iterator it = this->active.begin();
+       it != this->active.end(); it++) {
+
+    if (it->state == SOAP::SEARCHING) {
+
+      for (int i = 0; i < it->probing; i++) {
+
+        close(it->probes[i]);
+      }
+    } else {
+
+      close(it->fd);
+    }
+  }
+
+  for (std::unordered_map<uint64_t, std::vector<SOAP::Connection>>::iterator
+           it = this->idle.begin();
+       it != this->idle.end(); it++) {
+
+    for (std::vector<SOAP::Connection>::iterator c = it->second.begin();
+         c != it->second.end(); c++) {
+
+      close(c->fd);
+    }
+  }
+
+  if (this->fd_epoll != -1) {
+
+    close(this->fd_epoll);
+  }
+}
+
+void SOAP::deadline(const std::string &operation, long ms) {
+
+  this->deadlines[operation] = ms;
+}
+
+long SOAP::deadline(const std::string &operation) const {
+
+  std::unordered_map<std::string, long>::const_iterator it =
+      this->deadlines.find(operation);
+
+  return it != this->deadlines.end() ? it->second : this->timeout_ms;
+}
+
+bool SOAP::resolve(const std::string &ip, int port,
+                   struct sockaddr_in *remote) {
+
+  memset(remote, '\0', sizeof(*remote));
+
+  if (1 != inet_pton(AF_INET, ip.c_str(), &remote->sin_addr)) {
+
+    Log::err("Invalid SOAP address %s", ip.c_str());
+
+    return false;
+  }
+
+  remote->sin_family = AF_INET;
+  remote->sin_port = htons(port);
+
+  return true;
+}
+
+bool SOAP::request(const struct sockaddr_in &remote, const SOAP::Action &action,
+                   const std::string &arg, Callback callback, bool hop) {
+
+  if (this->fd_epoll == -1 || remote.sin_family != AF_INET) {
+
+    return false;
+  }
+
+  SOAP::Request &request =
+      this->prepare(remote, this->deadline(action.name), callback);
+
+  request.hop = hop;
+  request.action = &action;
+  request.arg = arg;
+
+  this->enqueue(request);
+
+  return true;
+}
+
+bool SOAP::http(const std::string &ip, int port, const std::string &method,
+                const std::string &path, const std::string &headers,
+                Callback callback) {
+
+  struct sockaddr_in remote;
+
+  if (this->fd_epoll == -1 || !SOAP::resolve(ip, port, &remote)) {
+
+    return false;
+  }
+
+  SOAP::Request &request =
+      this->prepare(remote, this->deadline(method), callback);
+
+  request.method = method;
+  request.path = path;
+  request.msg = method + " " + path +
+                " HTTP/1.1\r\n"
+                "Host: " +
+                ip + ":" + std::to_string(port) +
+                "\r\n"
+                "User-Agent: WeMo-daemon/1.0\r\n" +
+                headers +
+                "Connection: keep-alive\r\n"
+                "\r\n";
+
+  this->enqueue(request);
+
+  return true;
+}
+
+void SOAP::limit(double rate, double plug_rate, size_t plug_inflight) {
+
+  // configuring a bucket refills it, so a reload that keeps the rates must not
+  // hand out a fresh burst
+  if (rate != this->rate) {
+
+    this->global.configure(rate, rate);
+
+    this->rate = rate;
+  }
+
+  if (plug_rate != this->plug_rate) {
+
+    this->buckets.clear();
+
+    this->plug_rate = plug_rate;
+  }
+
+  this->plug_inflight = plug_inflight;
+}
+
+SOAP::Request &SOAP::prepare(const struct sockaddr_in &remote, long timeout_ms,
+                             Callback &callback) {
+
+  if (this->spare.empty()) {
+
+    this->spare.emplace_back();
+  }
+
+  this->queue.splice(this->queue.end(), this->spare, this->spare.begin());
+
+  // a recycled request keeps the capacity of its strings and response
+  SOAP::Request &request = this->queue.back();
+
+  request.remote = remote;
+  inet_ntop(AF_INET, &remote.sin_addr, request.ip, sizeof(request.ip));
+  request.port = ntohs(remote.sin_port);
+  request.hop = false;
+  request.probing = 0;
+  request.fd = -1;
+  request.action = nullptr;
+  request.arg.clear();
+  request.method.clear();
+  request.path.clear();
+  request.msg.clear();
+  request.timeout_ms = timeout_ms;
+  request.callback = std::move(callback);
+  request.status = SOAP::OK;
+
+  return request;
+}
+
+void SOAP::enqueue(SOAP::Request &request) {
+
+  struct timeval now, total = {request.timeout_ms / 1000,
+                               (request.timeout_ms % 1000) * 1000};
+
+  gettimeofday(&now, NULL);
+
+  // a request that cannot get a turn within its deadline is given up on
+  timeradd(&now, &total, &request.turn);
+
+  this->start();
+}
+
+void SOAP::start() {
+
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+
+  std::list<SOAP::Request>::iterator it = this->queue.begin();
+
+  while (it != this->queue.end() && this->active.size() < this->inflight &&
+         this->global.ready(now)) {
+
+    in_addr_t addr = it->remote.sin_addr.s_addr;
+
+    std::unordered_map<in_addr_t, size_t>::const_iterator l =
+        this->load.find(addr);
+
+    // a plug that has to wait keeps its requests in order behind the first
+    if ((l != this->load.end() && l->second >= this->plug_inflight) ||
+        !this->bucket(addr).ready(now)) {
+
+      it++;
+
+      continue;
+    }
+
+    this->global.take();
+
+    this->bucket(addr).take();
+
+    // the deadline runs from the launch, so the requests of a burst that
+    // waited for their turn still get all of their time on the wire
+    struct timeval total = {it->timeout_ms / 1000,
+                            (it->timeout_ms % 1000) * 1000};
+
+    timeradd(&now, &total, &it->expires);
+
+    std::list<SOAP::Request>::iterator next = std::next(it);
+
+    if (this->launch(it)) {
+
+      this->active.splice(this->active.end(), this->queue, it);
+    } else {
+
+      it->status = SOAP::FAILED;
+
+      this->done.splice(this->done.end(), this->queue, it);
+    }
+
+    it = next;
+  }
+}
+
+Bucket &SOAP::bucket(in_addr_t addr) {
+
+  std::unordered_map<in_addr_t, Bucket>::iterator it =
+      this->buckets.find(addr);
+  if (it == this->buckets.end()) {
+
+    it = this->buckets.emplace(addr, Bucket(this->plug_rate, this->plug_rate))
+             .first;
+  }
+
+  return it->second;
+}
+
+void SOAP::compose(SOAP::Request &request) {
+
+  // only the host and length vary, the rest is sent straight from the action
+  if (request.action != nullptr) {
+
+    request.length_preamble = snprintf(
+        request.preamble, sizeof(request.preamble),
+        "Host: %s:%d\r\nContent-Length: %zu\r\n\r\n", request.ip, request.port,
+        request.action->length_open + request.arg.size() +
+            request.action->length_close);
+  }
+
+  request.sent = 0;
+
+  struct iovec iov[5];
+
+  request.size = 0;
+  for (int i = this->vectors(request, iov); i > 0; i--) {
+
+    request.size += iov[i - 1].iov_len;
+  }
+}
+
+bool SOAP::launch(std::list<SOAP::Request>::iterator it) {
+
+  SOAP::Request &request = *it;
+
+  request.remote.sin_port = htons(request.port);
+
+  this->compose(request);
+
+  request.response.reset(
+      request.action != nullptr ? request.action->element : "",
+      request.action == nullptr && request.method == "GET");
+
+  struct epoll_event event;
+
+  int fd = this->acquire(request), yes = 1;
+
+  request.reused = fd != -1;
+
+  request.state = request.reused ? SOAP::SENDING : SOAP::CONNECTING;
+
+  if (!request.reused) {
+
+    if (-1 == (fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                           IPPROTO_TCP))) {
+
+      Log::perror("Failed to create TCP socket for SOAP request");
+
+      return false;
+    }
+
+    if (-1 == setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes))) {
+
+      Log::perror("Failed to set TCP no-delay");
+
+      goto FAIL;
+    }
+
+    if (0 == connect(fd, (struct sockaddr *)&request.remote,
+                     sizeof(request.remote))) {
+
+      request.state = SOAP::SENDING;
+    } else if (errno != EINPROGRESS) {
+
+      int error = errno;
+
+      close(fd);
+
+      if (this->searchable(request)) {
+
+        return this->search(it);
+      }
+
+      errno = error;
+
+      Log::perror("Failed to connect to %s:%d for SOAP request", request.ip,
+                  request.port);
+
+      return false;
+    }
+  }
+
+  event.events = EPOLLOUT;
+  event.data.fd = fd;
+  if (-1 == epoll_ctl(this->fd_epoll, EPOLL_CTL_ADD, fd, &event)) {
+
+    Log::perror("Failed to add SOAP request to epoll");
+
+    goto FAIL;
+  }
+
+  {
+    struct timeval now, offset = {this->connect_ms / 1000,
+                                  (this->connect_ms % 1000) * 1000};
+    gettimeofday(&now, NULL);
+
+    request.deadline = request.expires;
+
+    if (request.state == SOAP::CONNECTING) {
+
+      timeradd(&now, &offset, &offset);
+
+      if (timercmp(&offset, &request.deadline, <)) {
+
+        request.deadline = offset;
+      }
+    }
+  }
+
+  // entries stay at zero when idle, one per plug, so counting allocates nothing
+  ++this->load[request.remote.sin_addr.s_addr];
+
+  this->attach(fd, it);
+
+  request.fd = fd;
+
+  return true;
+
+FAIL:
+  close(fd);
+  return false;
+}
+
+bool SOAP::searchable(const SOAP::Request &request) const {
+
+  return request.hop && request.port >= SOAP::PORT_FIRST &&
+         request.port <= SOAP::PORT_LAST;
+}
+
+bool SOAP::search(std::list<SOAP::Request>::iterator it) {
+
+  SOAP::Request &request = *it;
+
+  // the port range is only searched once per request
+  request.hop = false;
+
+  request.probing = 0;
+
+  struct sockaddr_in remote = request.remote;
+
+  int yes = 1;
+
+  for (int port = SOAP::PORT_FIRST; port <= SOAP::PORT_LAST; port++) {
+
+    if (port == request.port) {
+
+      continue;
+    }
+
+    remote.sin_port = htons(port);
+
+    int fd;
+    if (-1 == (fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                           IPPROTO_TCP))) {
+
+      Log::perror("Failed to create TCP socket for SOAP port search");
+
+      continue;
+    }
+
+    struct epoll_event event;
+
+    event.events = EPOLLOUT;
+    event.data.fd = fd;
+
+    if (-1 == setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes)) ||
+        (0 != connect(fd, (struct sockaddr *)&remote, sizeof(remote)) &&
+         errno != EINPROGRESS) ||
+        -1 == epoll_ctl(this->fd_epoll, EPOLL_CTL_ADD, fd, &event)) {
+
+      close(fd);
+
+      continue;
+    }
+
+    this->attach(fd, it);
+
+    request.probes[request.probing] = fd;
+
+    request.ports[request.probing] = port;
+
+    ++request.probing;
+  }
+
+  if (request.probing == 0) {
+
+    Log::err("Failed to search the ports of %s for %s", request.ip,
+             this->label(request).c_str());
+
+    return false;
+  }
+
+  request.state = SOAP::SEARCHING;
+
+  request.fd = request.probes[0];
+
+  struct timeval now, offset = {this->connect_ms / 1000,
+                                (this->connect_ms % 1000) * 1000};
+  gettimeofday(&now, NULL);
+
+  timeradd(&now, &offset, &offset);
+
+  request.deadline =
+      timercmp(&offset, &request.expires, <) ? offset : request.expires;
+
+  ++this->load[request.remote.sin_addr.s_addr];
+
+  return true;
+}
+
+void SOAP::attach(int fd, std::list<SOAP::Request>::iterator it) {
+
+  if (this->sockets.size() <= (size_t)fd) {
+
+    this->sockets.resize(fd + 1, this->active.end());
+  }
+
+  this->sockets[fd] = it;
+}
+
+void SOAP::detach(int fd) {
+
+  epoll_ctl(this->fd_epoll, EPOLL_CTL_DEL, fd, NULL);
+
+  this->sockets[fd] = this->active.end();
+}
+
+void SOAP::abandon(SOAP::Request &request, int keep) {
+
+  for (int i = 0; i < request.probing; i++) {
+
+    if (request.probes[i] != keep) {
+
+      this->detach(request.probes[i]);
+
+      close(request.probes[i]);
+    }
+  }
+
+  request.probing = 0;
+}
+
+int SOAP::vectors(const SOAP::Request &request, struct iovec *iov) const {
+
+  if (request.action == nullptr) {
+
+    iov[0] = {(void *)request.msg.data(), request.msg.size()};
+
+    return 1;
+  }
+
+  iov[0] = {(void *)request.action->head, request.action->length_head};
+  iov[1] = {(void *)request.preamble, request.length_preamble};
+  iov[2] = {(void *)request.action->open, request.action->length_open};
+  iov[3] = {(void *)request.arg.data(), request.arg.size()};
+  iov[4] = {(void *)request.action->close, request.action->length_close};
+
+  return 5;
+}
+
+void SOAP::step(int fd) {
+
+  if ((size_t)fd >= this->sockets.size() ||
+      this->sockets[fd] == this->active.end()) {
+
+    return;
+  }
+
+  SOAP::Request &request = *this->sockets[fd];
+
+  if (request.state == SOAP::SEARCHING) {
+
+    int error = 0, i = 0;
+    socklen_t len = sizeof(error);
+
+    if (-1 == getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len)) {
+
+      error = errno;
+    }
+
+    while (request.probes[i] != fd) {
+
+      i++;
+    }
+
+    if (error != 0 && request.probing == 1) {
+
+      errno = error;
+
+      Log::perror("Failed to find %s on any port for %s", request.ip,
+                  this->label(request).c_str());
+
+      this->finish(fd, SOAP::FAILED);
+
+      return;
+    }
+
+    if (error != 0) {
+
+      this->detach(fd);
+
+      close(fd);
+
+      --request.probing;
+
+      request.probes[i] = request.probes[request.probing];
+      request.ports[i] = request.ports[request.probing];
+
+      request.fd = request.probes[0];
+
+      return;
+    }
+
+    // the first port to accept wins and the request carries on from there
+    request.port = request.ports[i];
+
+    request.remote.sin_port = htons(request.port);
+
+    this->abandon(request, fd);
+
+    request.fd = fd;
+
+    this->compose(request);
+
+    request.state = SOAP::SENDING;
+
+    request.deadline = request.expires;
+  }
+
+  if (request.state == SOAP::CONNECTING) {
+
+    int error = 0;
+    socklen_t len = sizeof(error);
+
+    if (-1 == getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len)) {
+
+      error = errno;
+    }
+
+    if (error != 0) {
+
+      this->retry(fd, error);
+
+      return;
+    }
+
+    request.state = SOAP::SENDING;
+
+    request.deadline = request.expires;
+  }
+
+  if (request.state == SOAP::SENDING) {
+
+    struct iovec iov[5];
+
+    int n = this->vectors(request, iov);
+
+    while (request.sent < request.size) {
+
+      int i = 0;
+
+      size_t skip = request.sent;
+      while (skip >= iov[i].iov_len) {
+
+        skip -= iov[i++].iov_len;
+      }
+
+      iov[i].iov_base = (char *)iov[i].iov_base + skip;
+      iov[i].iov_len -= skip;
+
+      struct msghdr msg = {};
+
+      msg.msg_iov = iov + i;
+      msg.msg_iovlen = n - i;
+
+      ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+
+      iov[i].iov_base = (char *)iov[i].iov_base - skip;
+      iov[i].iov_len += skip;
+
+      if (sent > 0) {
+
+        request.sent += sent;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+
+        return;
+      } else {
+
+        this->retry(fd, errno);
+
+        return;
+      }
+    }
+
+    struct epoll_event event;
+
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(this->fd_epoll, EPOLL_CTL_MOD, fd, &event);
+
+    request.state = SOAP::RECEIVING;
+
+    return;
+  }
+
+  char buff[2048];
+
+  ssize_t bytes;
+  while ((bytes = recv(fd, buff, sizeof(buff), 0)) > 0) {
+
+    request.response.feed(std::string_view(buff, bytes));
+
+    // the value is all that is needed, even when the body is still underway
+    if (request.response.ready() || request.response.failed()) {
+
+      this->finish(fd, SOAP::OK);
+
+      return;
+    }
+  }
+
+  if (bytes == 0 && request.response.eof()) {
+
+    this->finish(fd, SOAP::OK);
+  } else if (bytes == 0) {
+
+    this->retry(fd, ECONNRESET);
+  } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+
+    this->retry(fd, errno);
+  }
+}
+
+void SOAP::retry(int fd, int error) {
+
+  if ((size_t)fd >= this->sockets.size() ||
+      this->sockets[fd] == this->active.end()) {
+
+    return;
+  }
+
+  std::list<SOAP::Request>::iterator it = this->sockets[fd];
+
+  SOAP::Request &request = *it;
+
+  --this->load[request.remote.sin_addr.s_addr];
+
+  this->detach(fd);
+
+  close(fd);
+
+  // the plug dropped an idle connection, so will have dropped the others
+  if (request.reused) {
+
+    this->drain(request);
+
+    if (this->launch(it)) {
+
+      return;
+    }
+  } else if (request.state == SOAP::CONNECTING && this->searchable(request)) {
+
+    // a plug that restarted may listen on another of its ports
+    if (this->search(it)) {
+
+      return;
+    }
+  } else {
+
+    errno = error;
+
+    Log::perror("Failed SOAP request to %s:%d", request.ip, request.port);
+  }
+
+  request.status = SOAP::FAILED;
+
+  this->done.splice(this->done.end(), this->active, it);
+}
+
+void SOAP::finish(int fd, SOAP::Status status) {
+
+  if ((size_t)fd >= this->sockets.size() ||
+      this->sockets[fd] == this->active.end()) {
+
+    return;
+  }
+
+  std::list<SOAP::Request>::iterator it = this->sockets[fd];
+
+  SOAP::Request &request = *it;
+
+  if (request.state == SOAP::SEARCHING) {
+
+    this->abandon(request, fd);
+  }
+
+  --this->load[request.remote.sin_addr.s_addr];
+
+  this->detach(fd);
+
+  if (status == SOAP::OK && request.response.keep()) {
+
+    this->release(request, fd);
+  } else {
+
+    close(fd);
+  }
+
+  request.status = status;
+
+  this->done.splice(this->done.end(), this->active, it);
+}
+
+void SOAP::deliver() {
+
+  static const std::string none;
+
+  while (!this->done.empty()) {
+
+    SOAP::Request &request = this->done.front();
+
+    const std::string *value = &none;
+
+    if (request.status == SOAP::OK) {
+
+      const Response &response = request.response;
+
+      const char *element =
+          request.action != nullptr ? request.action->element : "";
+
+      if (response.fault) {
+
+        Log::err("SOAP fault %s (%s) in reply to %s from %s:%d",
+                 response.code.c_str(), response.description.c_str(),
+                 this->label(request).c_str(), request.ip,
+                 request.port);
+
+        request.status = SOAP::FAULT;
+
+        value = &response.code;
+      } else if (response.failed() || response.status != 200 ||
+                 (*element != '\0' && !response.found)) {
+
+        Log::err("Unexpected response (%d) to %s from %s:%d", response.status,
+                 this->label(request).c_str(), request.ip,
+                 request.port);
+
+        request.status = SOAP::INVALID;
+      } else if (*element == '\0') {
+
+        value = request.method == "GET" ? &response.content : &response.headers;
+      } else {
+
+        value = &response.value;
+      }
+    }
+
+    switch (request.status) {
+    case SOAP::OK:
+      ++this->succeeded;
+      break;
+    case SOAP::TIMEOUT:
+      ++this->timeouts;
+      break;
+    case SOAP::FAILED:
+      ++this->failures;
+      break;
+    case SOAP::FAULT:
+      ++this->faults;
+      break;
+    case SOAP::INVALID:
+      ++this->invalid;
+      break;
+    case SOAP::THROTTLED:
+      ++this->throttled;
+      break;
+    }
+
+    // the reply is read in place, so the slot is only recycled afterwards
+    request.callback(request.status, request.port, *value);
+
+    request.callback = nullptr;
+
+    this->spare.splice(this->spare.begin(), this->done, this->done.begin());
+  }
+}
+
+std::string SOAP::label(const SOAP::Request &request) const {
+
+  if (request.action != nullptr) {
+
+    return request.action->name;
+  }
+
+  return request.method + " " + request.path;
+}
+
+void SOAP::handler() {
+
+  this->deliver();
+
+  struct epoll_event events[64];
+
+  int n;
+  while ((n = epoll_wait(this->fd_epoll, events, 64, 0)) > 0) {
+
+    for (int i = 0; i < n; i++) {
+
+      this->step(events[i].data.fd);
+    }
+
+    if (n < 64) {
+
+      break;
+    }
+  }
+
+  if (n == -1 && errno != EINTR) {
+
+    Log::perror("Error while waiting for SOAP requests");
+  }
+
+  this->start();
+
+  this->deliver();
+}
+
+struct timeval *SOAP::timeout(struct timeval *tv) const {
+
+  if (!this->done.empty()) {
+
+    timerclear(tv);
+
+    return tv;
+  }
+
+  if (this->active.empty() && this->queue.empty()) {
+
+    return nullptr;
+  }
+
+  struct timeval now, next = this->active.empty()
+                                 ? this->queue.front().turn
+                                 : this->active.front().deadline;
+
+  gettimeofday(&now, NULL);
+
+  for (std::list<SOAP::Request>::const_iterator it = this->queue.begin();
+       it != this->queue.end(); it++) {
+
+    if (timercmp(&it->turn, &next, <)) {
+
+      next = it->turn;
+    }
+
+    std::unordered_map<in_addr_t, size_t>::const_iterator l =
+        this->load.find(it->remote.sin_addr.s_addr);
+    if (this->active.size() >= this->inflight ||
+        (l != this->load.end() && l->second >= this->plug_inflight)) {
+
+      continue;
+    }
+
+    // throttled requests are woken for the next token
+    std::unordered_map<in_addr_t, Bucket>::const_iterator b =
+        this->buckets.find(it->remote.sin_addr.s_addr);
+
+    long ms = std::max(this->global.wait(now),
+                       b != this->buckets.end() ? b->second.wait(now) : 0);
+
+    struct timeval wait = {ms / 1000, (ms % 1000) * 1000}, when;
+
+    timeradd(&now, &wait, &when);
+
+    if (timercmp(&when, &next, <)) {
+
+      next = when;
+    }
+  }
+
+  for (std::list<SOAP::Request>::const_iterator it = this->active.begin();
+       it != this->active.end(); it++) {
+
+    if (timercmp(&it->deadline, &next, <)) {
+
+      next = it->deadline;
+    }
+  }
+
+  if (timercmp(&now, &next, >=)) {
+
+    timerclear(tv);
+  } else {
+
+    timersub(&next, &now, tv);
+  }
+
+  return tv;
+}
+
+void SOAP::expire() {
+
+  struct timeval now;
+  gettimeofday(&now, NULL);
+
+  std::list<SOAP::Request>::iterator a = this->active.begin();
+  while (a != this->active.end()) {
+
+    std::list<SOAP::Request>::iterator it = a++;
+
+    SOAP::Request &request = *it;
+
+    if (timercmp(&now, &request.deadline, <)) {
+
+      continue;
+    }
+
+    // a plug that does not answer on its port may have moved to another one
+    if (request.state == SOAP::CONNECTING && this->searchable(request) &&
+        timercmp(&now, &request.expires, <)) {
+
+      --this->load[request.remote.sin_addr.s_addr];
+
+      this->detach(request.fd);
+
+      close(request.fd);
+
+      if (this->search(it)) {
+
+        continue;
+      }
+
+      request.status = SOAP::TIMEOUT;
+
+      this->done.splice(this->done.end(), this->active, it);
+
+      continue;
+    }
+
+    Log::err("%s to %s:%d timed out", this->label(request).c_str(),
+             request.ip, request.port);
+
+    this->finish(request.fd, SOAP::TIMEOUT);
+  }
+
+  std::list<SOAP::Request>::iterator q = this->queue.begin();
+  while (q != this->queue.end()) {
+
+    if (timercmp(&now, &q->turn, >=)) {
+
+      Log::warn("%s to %s:%d gave up waiting for its turn",
+                this->label(*q).c_str(), q->ip, q->port);
+
+      q->status = SOAP::THROTTLED;
+
+      this->done.splice(this->done.end(), this->queue, q++);
+    } else {
+
+      q++;
+    }
+  }
+
+  for (std::unordered_map<uint64_t, std::vector<SOAP::Connection>>::iterator
+           it = this->idle.begin();
+       it != this->idle.end(); it++) {
+
+    std::vector<SOAP::Connection>::iterator c = it->second.begin();
+    while (c != it->second.end()) {
+
+      if (now.tv_sec - c->used >= SOAP::IDLE) {
+
+        close(c->fd);
+
+        c = it->second.erase(c);
+      } else {
+
+        c++;
+      }
+    }
+  }
+
+  this->start();
+
+  this->deliver();
+}
+
+int SOAP::acquire(const SOAP::Request &request) {
+
+  std::unordered_map<uint64_t, std::vector<SOAP::Connection>>::iterator it =
+      this->idle.find(SOAP::endpoint(request));
+  if (it == this->idle.end()) {
+
+    return -1;
+  }
+
+  time_t now = time(NULL);
+
+  char c;
+
+  while (!it->second.empty()) {
+
+    SOAP::Connection conn = it->second.back();
+
+    it->second.pop_back();
+
+    // a readable idle socket means the plug closed it or sent junk
+    if (now - conn.used < SOAP::IDLE &&
+        -1 == recv(conn.fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) &&
+        (errno == EAGAIN || errno == EWOULDBLOCK)) {
+
+      return conn.fd;
+    }
+
+    close(conn.fd);
+  }
+
+  return -1;
+}
+
+void SOAP::release(const SOAP::Request &request, int fd) {
+
+  std::vector<SOAP::Connection> &pool = this->idle[SOAP::endpoint(request)];
+
+  if (pool.size() >= SOAP::POOL) {
+
+    close(fd);
+
+    return;
+  }
+
+  pool.push_back((SOAP::Connection){fd, time(NULL)});
+}
+
+void SOAP::drain(const SOAP::Request &request) {
+
+  std::unordered_map<uint64_t, std::vector<SOAP::Connection>>::iterator it =
+      this->idle.find(SOAP::endpoint(request));
+  if (it == this->idle.end()) {
+
+    return;
+  }
+
+  for (std::vector<SOAP::Connection>::iterator c = it->second.begin();
+       c != it->second.end(); c++) {
+
+    close(c->fd);
+  }
+
+  this->idle.erase(it);
+}
@@ -0,0 +1,241 @@
+/**
+ *  @file   SOAP.h
+ *  @brief  SOAP Class Definition
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ ***********************************************/
+
+#ifndef SOAP_H_
+#define SOAP_H_
+
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "Bucket.h"
+#include "Log.h"
+#include "Response.h"
+
+// the fixed parts of a basicevent request, rendered at compile time
+#define SOAP_HEAD(NAME)                                                        \
+  "POST /upnp/control/basicevent1 HTTP/1.1\r\n"                                \
+  "User-Agent: WeMo-daemon/1.0\r\n"                                            \
+  "Content-Type: text/xml; charset=\"utf-8\"\r\n"                             \
+  "Accept: application/xml\r\n"                                                \
+  "SOAPAction: \"urn:Belkin:service:basicevent:1#" NAME "\"\r\n"               \
+  "Connection: keep-alive\r\n"
+
+#define SOAP_OPEN(NAME, OPEN)                                                  \
+  "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"                               \
+  "<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" "         \
+  "s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\">"             \
+  "<s:Body>"                                                                   \
+  "<u:" NAME " xmlns:u=\"urn:Belkin:service:basicevent:1\">" OPEN
+
+#define SOAP_CLOSE(NAME, CLOSE)                                                \
+  CLOSE "</u:" NAME ">"                                                        \
+        "</s:Body>"                                                            \
+        "</s:Envelope>\r\n"
+
+#define SOAP_ACTION(NAME, ELEMENT, OPEN, CLOSE)                                \
+  {NAME,                                                                       \
+   ELEMENT,                                                                    \
+   SOAP_HEAD(NAME),                                                            \
+   sizeof(SOAP_HEAD(NAME)) - 1,                                                \
+   SOAP_OPEN(NAME, OPEN),                                                      \
+   sizeof(SOAP_OPEN(NAME, OPEN)) - 1,                                          \
+   SOAP_CLOSE(NAME, CLOSE),                                                    \
+   sizeof(SOAP_CLOSE(NAME, CLOSE)) - 1}
+
+class SOAP {
+
+public:
+  // THROTTLED requests never got a turn, so they say nothing about the plug
+  enum Status { OK, TIMEOUT, FAILED, FAULT, INVALID, THROTTLED };
+
+  typedef struct {
+    const char *name;
+    const char *element;
+    const char *head;
+    size_t length_head;
+    const char *open;
+    size_t length_open;
+    const char *close;
+    size_t length_close;
+  } Action;
+
+  static constexpr SOAP::Action GetFriendlyName =
+      SOAP_ACTION("GetFriendlyName", "FriendlyName", "", "");
+  static constexpr SOAP::Action SetFriendlyName = SOAP_ACTION(
+      "SetFriendlyName", "FriendlyName", "<FriendlyName>", "</FriendlyName>");
+  static constexpr SOAP::Action GetBinaryState =
+      SOAP_ACTION("GetBinaryState", "BinaryState", "", "");
+  static constexpr SOAP::Action SetBinaryState = SOAP_ACTION(
+      "SetBinaryState", "BinaryState", "<BinaryState>", "</BinaryState>");
+
+  typedef std::function<void(SOAP::Status status, int port,
+                             const std::string &value)>
+      Callback;
+
+  static const int PORT_FIRST = 49152;
+  static const int PORT_LAST = 49155;
+  static const int PORTS = PORT_LAST - PORT_FIRST + 1;
+
+  SOAP(size_t inflight = 1024, long timeout_ms = 5000);
+  ~SOAP();
+
+  void deadline(const std::string &operation, long ms);
+  void connect_timeout(long ms) { this->connect_ms = ms; }
+  void limit(double rate, double plug_rate, size_t plug_inflight);
+
+  static bool resolve(const std::string &ip, int port,
+                      struct sockaddr_in *remote);
+
+  bool request(const struct sockaddr_in &remote, const SOAP::Action &action,
+               const std::string &arg, Callback callback, bool hop = true);
+  bool http(const std::string &ip, int port, const std::string &method,
+            const std::string &path, const std::string &headers,
+            Callback callback);
+
+  void handler();
+  struct timeval *timeout(struct timeval *tv) const;
+  void expire();
+
+  size_t waiting() const { return this->queue.size(); }
+
+  int fd_epoll;
+
+  unsigned long succeeded = 0;
+  unsigned long timeouts = 0;
+  unsigned long failures = 0;
+  unsigned long faults = 0;
+  unsigned long invalid = 0;
+  unsigned long throttled = 0;
+
+private:
+  // a SEARCHING request connects to all ports of its plug at once
+  enum State { CONNECTING, SEARCHING, SENDING, RECEIVING };
+
+  typedef struct {
+    char ip[INET_ADDRSTRLEN];
+    int port;
+    bool hop;
+    int probes[SOAP::PORTS];
+    int ports[SOAP::PORTS];
+    int probing;
+    struct sockaddr_in remote;
+    int fd;
+    const SOAP::Action *action;
+    std::string arg;
+    std::string method;
+    std::string path;
+    std::string msg;
+    char preamble[80];
+    size_t length_preamble;
+    Callback callback;
+    SOAP::State state;
+    bool reused;
+    size_t sent;
+    size_t size;
+    Response response;
+    long timeout_ms;
+    struct timeval turn;
+    struct timeval expires;
+    struct timeval deadline;
+    SOAP::Status status;
+  } Request;
+
+  typedef struct {
+    int fd;
+    time_t used;
+  } Connection;
+
+  static const size_t POOL = 2;
+
+  static const time_t IDLE = 20;
+
+  size_t inflight;
+
+  long timeout_ms;
+
+  long connect_ms;
+
+  std::unordered_map<std::string, long> deadlines;
+
+  // requests move between these lists and are recycled through spare, so a
+  // steady flow of them allocates nothing
+  std::list<SOAP::Request> queue;
+
+  std::list<SOAP::Request> active;
+
+  std::list<SOAP::Request> done;
+
+  std::list<SOAP::Request> spare;
+
+  std::vector<std::list<SOAP::Request>::iterator> sockets;
+
+  Bucket global;
+
+  double rate = -1;
+
+  double plug_rate = -1;
+
+  size_t plug_inflight = 1024;
+
+  std::unordered_map<in_addr_t, Bucket> buckets;
+
+  std::unordered_map<in_addr_t, size_t> load;
+
+  std::unordered_map<uint64_t, std::vector<SOAP::Connection>> idle;
+
+  SOAP::Request &prepare(const struct sockaddr_in &remote, long timeout_ms,
+                         Callback &callback);
+  void enqueue(SOAP::Request &request);
+  void start();
+  Bucket &bucket(in_addr_t addr);
+  bool launch(std::list<SOAP::Request>::iterator it);
+  void compose(SOAP::Request &request);
+  int vectors(const SOAP::Request &request, struct iovec *iov) const;
+  bool searchable(const SOAP::Request &request) const;
+  bool search(std::list<SOAP::Request>::iterator it);
+  void attach(int fd, std::list<SOAP::Request>::iterator it);
+  void detach(int fd);
+  void abandon(SOAP::Request &request, int keep);
+  void step(int fd);
+  void retry(int fd, int error);
+  void finish(int fd, SOAP::Status status);
+  long deadline(const std::string &operation) const;
+  void deliver();
+  std::string label(const SOAP::Request &request) const;
+
+  int acquire(const SOAP::Request &request);
+  void release(const SOAP::Request &request, int fd);
+  void drain(const SOAP::Request &request);
+
+  static uint64_t endpoint(const SOAP::Request &request) {
+    return (uint64_t)request.remote.sin_addr.s_addr << 16 | request.port;
+  }
+};
+
+#endif
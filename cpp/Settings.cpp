@@ -50,7 +50,7 @@ int Settings::parse() {
 
   size_t n = 64;
 
-  char *l = (char *)malloc(n), s[64], k[64], v[64];
+  char *l = (char *)malloc(n), s[64], k[64];
 
   FILE *f = NULL;
   if (NULL == (f = fopen(this->filename.c_str(), "r"))) {
@@ -72,9 +72,22 @@ int Settings::parse() {
       continue;
     }
 
-    if (sscanf(l, "%63[^=]=%63s ", k, v) == 2) {
+    // values run to the end of the line, e.g., a list of plug names
+    char *v = strchr(l, '=');
+    if (v == NULL || sscanf(l, "%63[^=]", k) != 1) {
 
-      ini[s][k] = v;
+      continue;
+    }
+
+    std::string value(v + 1);
+
+    value.erase(value.find_last_not_of(" \t\r\n") + 1);
+
+    value.erase(0, value.find_first_not_of(" \t"));
+
+    if (!value.empty()) {
+
+      ini[s][k] = value;
     }
   }
 
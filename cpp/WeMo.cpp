@@ -9,11 +9,31 @@
 
 #include "WeMo.h"
 
+const WeMo::Timeout WeMo::TIMEOUTS[] = {
+    {"connect", "", 1000},
+    {"state", "GetBinaryState", 2000},
+    {"switch", "SetBinaryState", 3000},
+    {"name", "GetFriendlyName", 2000},
+    {"name", "SetFriendlyName", 2000},
+    {"subscribe", "SUBSCRIBE", 2000},
+    {"describe", "GET", 2000},
+    {"group", "", 5000}};
+
 WeMo::WeMo(const Settings &settings) {
 
-  discover();
+  plugs.load();
+
+  plugs.on_failure(
+      [this](const Registry::Handle &) { tighten("Plug requests failed"); });
 
   load_settings(settings);
+
+  // the first poll should not repeat the scan that starts here
+  rescan_t = time(NULL) + rescan_interval;
+
+  discover();
+
+  sweep();
 }
 
 bool WeMo::load_settings(const Settings &settings) {
@@ -22,8 +42,8 @@ bool WeMo::load_settings(const Settings &settings) {
 
   timers.clear();
 
-  this->timers["poll"].push_back(
-      (WeMo::Timer){.plug = NULL, .time = 3600, .action = "poll"});
+  this->timers["poll"].push_back((WeMo::Timer){
+      .plug = {}, .group = {}, .time = 3600, .action = "poll"});
 
   std::string name;
 
@@ -31,6 +51,12 @@ bool WeMo::load_settings(const Settings &settings) {
 
   time_t t;
 
+  std::map<std::string, std::string> global;
+  if (settings.find("global") != settings.end()) {
+
+    global = settings["global"];
+  }
+
   if (settings.find("global") != settings.end()) {
 
     if (settings["global"].find("poll") != settings["global"].end()) {
@@ -39,12 +65,13 @@ bool WeMo::load_settings(const Settings &settings) {
 
       t = strtol(settings["global"]["poll"].c_str(), NULL, 10);
 
-      if (t >= 60) {
+      if (t >= POLL_MIN) {
 
         timers["poll"].begin()->time = t;
       } else {
 
-        Log::warn("Minimal polling interval is 60 s, not setting %d s", t);
+        Log::warn("Minimal polling interval is %ld s, not setting %ld s",
+                  POLL_MIN, t);
 
         t = tt;
       }
@@ -57,6 +84,25 @@ bool WeMo::load_settings(const Settings &settings) {
       }
     }
 
+    if (global.find("rescan") != global.end()) {
+
+      t = strtol(global["rescan"].c_str(), NULL, 10);
+
+      if (t >= POLL_MIN) {
+
+        if (t != rescan_interval) {
+
+          Log::info("Rescan interval changed to %ld s", t);
+
+          rescan_interval = t;
+        }
+      } else {
+
+        Log::warn("Minimal rescan interval is %ld s, not setting %ld s",
+                  POLL_MIN, t);
+      }
+    }
+
     if (settings["global"].find("latitude") != settings["global"].end()) {
 
       this->latitude = strtof(settings["global"]["latitude"].c_str(), nullptr);
@@ -69,435 +115,1682 @@ bool WeMo::load_settings(const Settings &settings) {
     }
   }
 
-  poll_t = time(NULL) + timers["poll"].begin()->time;
+  std::vector<std::string> interfaces;
+
+  if (global.find("interfaces") != global.end()) {
+
+    std::istringstream iss(global["interfaces"]);
+
+    for (std::string token; std::getline(iss, token, ',');) {
+
+      interfaces.push_back(token);
+    }
+  }
+
+  configure(interfaces);
+
+  subscribing = global.find("events") == global.end() ||
+                global["events"] != "false";
+
+  if (subscribing) {
+
+    subscribing = events.listen();
+  }
+
+  std::map<std::string, std::string> deadlines;
+  if (settings.find("timeouts") != settings.end()) {
+
+    deadlines = settings["timeouts"];
+  }
+
+  for (size_t i = 0; i < sizeof(WeMo::TIMEOUTS) / sizeof(*WeMo::TIMEOUTS);
+       i++) {
+
+    const WeMo::Timeout &d = WeMo::TIMEOUTS[i];
+
+    long ms = d.ms;
+
+    if (deadlines.find(d.key) != deadlines.end()) {
+
+      t = strtol(deadlines[d.key].c_str(), NULL, 10);
+
+      if (t >= 100) {
+
+        ms = t;
+      } else {
+
+        Log::warn("Minimal %s timeout is 100 ms, not setting %ld ms", d.key,
+                  t);
+      }
+    }
+
+    if (strcmp(d.key, "connect") == 0) {
+
+      soap.connect_timeout(ms);
+    } else if (strcmp(d.key, "group") == 0) {
+
+      group_ms = ms;
+    } else {
+
+      soap.deadline(d.operation, ms);
+    }
+  }
+
+  soap.limit(global.find("rate") != global.end()
+                 ? strtod(global["rate"].c_str(), NULL)
+                 : 20,
+             global.find("plug_rate") != global.end()
+                 ? strtod(global["plug_rate"].c_str(), NULL)
+                 : 5,
+             global.find("plug_connections") != global.end()
+                 ? std::max(1L, strtol(global["plug_connections"].c_str(),
+                                       NULL, 10))
+                 : 2);
+
+  std::map<std::string, std::string> retries;
+  if (settings.find("retry") != settings.end()) {
+
+    retries = settings["retry"];
+  }
+
+  retry.policy(
+      retries.find("attempts") != retries.end()
+          ? std::max(1L, strtol(retries["attempts"].c_str(), NULL, 10))
+          : 5,
+      retries.find("backoff") != retries.end()
+          ? std::max(100L, strtol(retries["backoff"].c_str(), NULL, 10))
+          : 1000,
+      retries.find("max_backoff") != retries.end()
+          ? strtol(retries["max_backoff"].c_str(), NULL, 10)
+          : 60000,
+      retries.find("expiry") != retries.end()
+          ? strtol(retries["expiry"].c_str(), NULL, 10)
+          : 600);
+
+  sweeps.clear();
+
+  if (global.find("sweep") != global.end()) {
+
+    std::istringstream iss(global["sweep"]);
+
+    for (std::string token; std::getline(iss, token, ',');) {
+
+      sweeps.push_back(token);
+    }
+  }
+
+  if (global.find("neighbors") != global.end() &&
+      global["neighbors"] == "true") {
+
+    neighbors.open();
+  } else {
+
+    neighbors.close();
+  }
+
+  poll_interval = std::min(poll_interval, timers["poll"].begin()->time);
+
+  if (poll_t == 0 || poll_t > time(NULL) + poll_interval) {
+
+    poll_t = time(NULL) + poll_interval;
+  }
+
+  Sun *sun = nullptr;
+
+  for (Registry::iterator it = this->plugs.begin(); it != this->plugs.end();
+       it++) {
+
+    Registry::Handle plug = it->second;
+
+    if ((name = plug->name).empty()) {
+
+      continue;
+    }
+
+    schedule(settings, name, plug, "", sun);
+  }
+
+  groups.clear();
+
+  for (std::map<std::string,
+                std::map<std::string, std::string>>::const_iterator it =
+           settings.begin();
+       it != settings.end(); it++) {
+
+    if (it->first.compare(0, 6, "group:") != 0) {
+
+      continue;
+    }
+
+    const std::string group = it->first.substr(6);
+
+    std::vector<std::weak_ptr<Plug>> &members = groups[group];
+
+    std::map<std::string, std::string>::const_iterator list =
+        it->second.find("plugs");
+    if (list != it->second.end()) {
+
+      std::istringstream iss(list->second);
+
+      for (std::string token; std::getline(iss, token, ',');) {
+
+        Registry::Handle plug = plugs.find_name(token);
+        if (plug) {
+
+          members.push_back(plug);
+        }
+      }
+    }
+
+    schedule(settings, it->first, {}, group, sun);
+  }
+
+  if (sun) {
+
+    delete sun;
+  }
+
+  lux_control.clear();
+
+  lux_on = lux_off = -1;
+
+  if (settings.find("serial") != settings.end()) {
+
+    if (settings["serial"].find("onlux") != settings["serial"].end()) {
+
+      lux_on = strtol(settings["serial"]["onlux"].c_str(), nullptr, 10);
+    }
+
+    if (settings["serial"].find("offlux") != settings["serial"].end()) {
+
+      lux_off = strtol(settings["serial"]["offlux"].c_str(), nullptr, 10);
+    }
+
+    if (settings["serial"].find("controls") != settings["serial"].end()) {
+
+      std::istringstream iss(settings["serial"]["controls"]);
+
+      for (std::string token; std::getline(iss, token, ',');) {
+
+        std::map<std::string, std::vector<std::weak_ptr<Plug>>>::iterator
+            group = groups.find(token);
+        if (group != groups.end()) {
+
+          lux_control.insert(lux_control.end(), group->second.begin(),
+                             group->second.end());
+
+          continue;
+        }
+
+        Registry::Handle plug = plugs.find_name(token);
+        if (plug) {
+
+          lux_control.push_back(plug);
+        }
+      }
+
+      // a plug listed by name and through a group is switched only once
+      std::unordered_set<Plug *> seen;
+
+      std::vector<std::weak_ptr<Plug>>::iterator it = lux_control.begin();
+      while (it != lux_control.end()) {
+
+        Registry::Handle plug = it->lock();
+        if (!plug || !seen.insert(plug.get()).second) {
+
+          it = lux_control.erase(it);
+        } else {
+
+          it++;
+        }
+      }
+    }
+  }
+
+  roster.clear();
+
+  for (Registry::iterator it = plugs.begin(); it != plugs.end(); it++) {
+
+    if (!it->second->name.empty()) {
+
+      roster.emplace_back(it->second, it->second->name);
+    }
+  }
+
+  plugs.save(true);
+
+  return true;
+}
+
+void WeMo::schedule(const Settings &settings, const std::string &section,
+                    std::weak_ptr<Plug> plug, const std::string &group,
+                    Sun *&sun) {
+
+  if (settings.find(section) == settings.end()) {
+
+    return;
+  }
+
+  time_t t;
+
+
+  if (settings[section].find("sun") != settings[section].end()) {
+
+    if (settings[section]["sun"] == "true") {
+
+      if (!sun) {
+
+        sun = new Sun(latitude, longitude);
+      }
+
+      char k[8], wday_val[16];
+
+      int time_val;
+
+      if (settings[section].find("rise") != settings[section].end()) {
+
+        if ((t = parse_time(sun->rise().c_str())) != -1) {
+
+          std::istringstream iss(settings[section]["rise"]);
+
+          for (std::string token; std::getline(iss, token, ',');) {
+
+            int nval = sscanf(token.c_str(), "%7[^:]:%d%%%15s", k,
+                              &time_val, wday_val);
+
+            if (nval > 1 && nval < 4) {
+
+              time_t wday = nval > 2 ? parse_wday(wday_val) : 0;
+
+              if (strcmp(k, "on") == 0) {
+
+                this->timers["sun"].push_back(
+                    (WeMo::Timer){.plug = plug, .group = group,
+                                  .time = (t + time_val) | wday,
+                                  .action = "on"});
+              } else if (strcmp(k, "off") == 0) {
+
+                this->timers["sun"].push_back(
+                    (WeMo::Timer){.plug = plug, .group = group,
+                                  .time = (t + time_val) | wday,
+                                  .action = "off"});
+              } else {
+
+                Log::warn("Invalid parameter in sun rise "
+                          "options '%s' ... "
+                          "ignoring\n",
+                          k);
+              }
+            } else {
+
+              Log::warn("Failed to parse sun rise "
+                        "options: '%s' ... ignoring\n",
+                        token.c_str());
+            }
+          }
+        } else {
+
+          Log::warn("Failed to parse sun rise for '%s' ... ignoring",
+                    section.c_str());
+        }
+      }
+
+      if (settings[section].find("set") != settings[section].end()) {
+
+        if ((t = parse_time(sun->set().c_str())) != -1) {
+
+          std::istringstream iss(settings[section]["set"]);
+
+          for (std::string token; std::getline(iss, token, ',');) {
+
+            int nval = sscanf(token.c_str(), "%7[^:]:%d%%%15s", k,
+                              &time_val, wday_val);
+
+            if (nval > 1 && nval < 4) {
+
+              time_t wday = nval > 2 ? parse_wday(wday_val) : 0;
+
+              if (strcmp(k, "on") == 0) {
+
+                this->timers["sun"].push_back(
+                    (WeMo::Timer){.plug = plug, .group = group,
+                                  .time = (t + time_val) | wday,
+                                  .action = "on"});
+              } else if (strcmp(k, "off") == 0) {
+
+                this->timers["sun"].push_back(
+                    (WeMo::Timer){.plug = plug, .group = group,
+                                  .time = (t + time_val) | wday,
+                                  .action = "off"});
+              } else {
+
+                Log::warn("Invalid parameter in sun set options '%s' ... "
+                          "ignoring\n",
+                          k);
+              }
+            } else {
+
+              Log::warn(
+                  "Failed to parse sun set options: '%s' ... ignoring\n",
+                  token.c_str());
+            }
+          }
+        } else {
+
+          Log::warn("Failed to parse sun set for '%s' ... ignoring",
+                    section.c_str());
+        }
+      }
+    }
+  }
+
+  if (settings[section].find("daily") != settings[section].end()) {
+
+    if (settings[section]["daily"] == "true") {
+
+      if (settings[section].find("ontimes") != settings[section].end()) {
+
+        std::istringstream iss(settings[section]["ontimes"]);
+
+        for (std::string token; std::getline(iss, token, ',');) {
+
+          if ((t = parse_time(token.c_str())) != -1) {
+
+            this->timers["daily"].push_back((WeMo::Timer){
+                .plug = plug, .group = group, .time = t, .action = "on"});
+          } else {
+
+            Log::warn("Failed to parse on time for '%s' ... ignoring",
+                      section.c_str());
+          }
+        }
+      }
+
+      if (settings[section].find("offtimes") != settings[section].end()) {
+
+        std::istringstream iss(settings[section]["offtimes"]);
+
+        for (std::string token; std::getline(iss, token, ',');) {
+
+          if ((t = parse_time(token.c_str())) != -1) {
+
+            this->timers["daily"].push_back((WeMo::Timer){
+                .plug = plug, .group = group, .time = t, .action = "off"});
+          } else {
+
+            Log::warn("Failed to parse off time for '%s' ... ignoring",
+                      section.c_str());
+          }
+        }
+      }
+    }
+  }
+}
+
+void WeMo::check_lux(uint32_t lux) {
+
+  static uint32_t lux_prev = 0;
+
+  if (lux < lux_on && lux_prev >= lux_on) {
+
+    dispatch("serial", lux_control, "on", time(NULL));
+  } else if (lux > lux_off && lux_prev <= lux_off) {
+
+    dispatch("serial", lux_control, "off", time(NULL));
+  }
+
+  lux_prev = lux;
+}
+
+void WeMo::command(const Registry::Handle &plug, const std::string &action,
+                   time_t scheduled) {
+
+  if (action != "on" && action != "off") {
+
+    return;
+  }
+
+  Log::info("Sending '%s' to %s", action == "on" ? "ON" : "OFF",
+            plug->name.c_str());
+
+  send(
+      plug, action,
+      [plug, action](WeMo::Result result) {
+        if (result == WeMo::FAILED) {
+          Log::err("Failed to send '%s' to %s", action.c_str(),
+                   plug->name.c_str());
+        } else if (result == WeMo::SUPERSEDED) {
+          Log::info("Dropped '%s' to %s, superseded by a later command",
+                    action.c_str(), plug->name.c_str());
+        }
+      },
+      scheduled);
+}
+
+void WeMo::send(const Registry::Handle &plug, const std::string &action,
+                WeMo::Sent done, time_t scheduled) {
+
+  // only the latest intent for a plug is ever transmitted
+  const unsigned long sequence = ++plug->sequence;
+
+  const std::string key = plug->udn.empty() ? plug->ip : plug->udn;
+
+  // older commands backing off give up their slot right away
+  retry.wake(key);
+
+  executor.submit(key, [this, plug, action, sequence, key, scheduled,
+                        done](Executor::Finished finished) {
+    attempt(plug, action, 1, sequence, key, scheduled, done, finished);
+  });
+}
+
+void WeMo::attempt(const Registry::Handle &plug, const std::string &action,
+                   int n, unsigned long sequence, const std::string &key,
+                   time_t scheduled, WeMo::Sent done,
+                   Executor::Finished finished) {
+
+  if (sequence != plug->sequence) {
+
+    ++superseded;
+
+    done(WeMo::SUPERSEDED);
+
+    finished();
+
+    return;
+  }
+
+  // backing off gives the worker back but keeps the queue of this plug
+  // blocked, so its commands stay in order without holding up other plugs
+  Plug::Done sent = [this, plug, action, n, sequence, key, scheduled, done,
+                     finished](bool ok) {
+    long ms = ok ? 0 : retry.delay(n);
+    if (!ok && sequence == plug->sequence && retry.allowed(n, ms, scheduled)) {
+      Log::warn("Failed to send '%s' to %s, retrying in %ld ms (attempt %d "
+                "of %d)",
+                action.c_str(), plug->name.c_str(), ms, n + 1,
+                retry.max_attempts());
+      retry.after(key, ms,
+                  [this, plug, action, n, sequence, key, scheduled, done]() {
+                    executor.resume(key, [this, plug, action, n, sequence,
+                                          key, scheduled,
+                                          done](Executor::Finished finished) {
+                      attempt(plug, action, n + 1, sequence, key, scheduled,
+                              done, finished);
+                    });
+                  });
+      executor.suspend(key);
+      return;
+    }
+    if (!ok && sequence != plug->sequence) {
+      ++superseded;
+      done(WeMo::SUPERSEDED);
+    } else {
+      done(ok ? WeMo::OK : WeMo::FAILED);
+    }
+    finished();
+  };
+
+  if (action == "on") {
+
+    plug->On(soap, sent, sequence);
+  } else {
+
+    plug->Off(soap, sent, sequence);
+  }
+}
+
+void WeMo::dispatch(const std::string &group,
+                    const std::vector<std::weak_ptr<Plug>> &members,
+                    const std::string &action, time_t scheduled) {
+
+  if (action != "on" && action != "off") {
+
+    return;
+  }
+
+  std::shared_ptr<WeMo::Dispatch> d = std::make_shared<WeMo::Dispatch>();
+
+  d->group = group;
+
+  d->action = action;
+
+  gettimeofday(&d->started, NULL);
+
+  struct timeval span = {this->group_ms / 1000,
+                         (this->group_ms % 1000) * 1000};
+
+  timeradd(&d->started, &span, &d->deadline);
+
+  std::vector<Registry::Handle> targets;
+
+  for (std::vector<std::weak_ptr<Plug>>::const_iterator it = members.begin();
+       it != members.end(); it++) {
+
+    if (Registry::Handle plug = it->lock()) {
+
+      targets.push_back(plug);
+
+      d->results.emplace_back(plug->name, "pending");
+    }
+  }
+
+  if (targets.empty()) {
+
+    Log::warn("No Plugs in group '%s' to send '%s' to", group.c_str(),
+              action.c_str());
+
+    return;
+  }
+
+  d->pending = targets.size();
+
+  dispatches.push_back(d);
+
+  // every member goes out at once, one plug never waits for another, and the
+  // group deadline only bounds the summary, a member still pending then keeps
+  // being sent and retried like any other command
+  for (size_t i = 0; i < targets.size(); i++) {
+
+    const Registry::Handle &plug = targets[i];
+
+    send(
+        plug, action,
+        [this, d, i, plug, action](WeMo::Result result) {
+          static const char *results[] = {"ok", "failed", "superseded"};
+          if (d->reported && result == WeMo::OK) {
+            Log::info("Sent '%s' to %s of group '%s'", action.c_str(),
+                      plug->name.c_str(), d->group.c_str());
+          } else if (d->reported && result == WeMo::FAILED) {
+            Log::err("Failed to send '%s' to %s of group '%s'",
+                     action.c_str(), plug->name.c_str(), d->group.c_str());
+          }
+          if (d->reported) {
+            return;
+          }
+          d->results[i].second = results[result];
+          if (--d->pending == 0) {
+            report(d);
+          }
+        },
+        scheduled);
+  }
+}
+
+void WeMo::report(const std::shared_ptr<WeMo::Dispatch> &d) {
+
+  d->reported = true;
+
+  dispatches.erase(std::remove(dispatches.begin(), dispatches.end(), d),
+                   dispatches.end());
+
+  struct timeval now, elapsed;
+
+  gettimeofday(&now, NULL);
+
+  timersub(&now, &d->started, &elapsed);
+
+  size_t ok = 0;
+
+  std::string members;
+
+  for (std::vector<std::pair<std::string, const char *>>::const_iterator it =
+           d->results.begin();
+       it != d->results.end(); it++) {
+
+    if (strcmp(it->second, "ok") == 0) {
+
+      ++ok;
+    }
+
+    members += (members.empty() ? "" : ", ") + it->first + " " + it->second;
+  }
+
+  long ms = elapsed.tv_sec * 1000 + elapsed.tv_usec / 1000;
+
+  if (ok == d->results.size()) {
+
+    Log::info("Sent '%s' to group '%s': %zu/%zu ok in %ld ms (%s)",
+              d->action == "on" ? "ON" : "OFF", d->group.c_str(), ok,
+              d->results.size(), ms, members.c_str());
+  } else {
+
+    Log::err("Sent '%s' to group '%s': %zu/%zu ok in %ld ms (%s)",
+             d->action == "on" ? "ON" : "OFF", d->group.c_str(), ok,
+             d->results.size(), ms, members.c_str());
+  }
+}
+
+void WeMo::display_plugs() {
+  fprintf(Log::stream,
+          "---------------------------------------------------------------"
+          "----------------\n"
+          "                                   Plugs                       "
+          "                \n"
+          "---------------------------------------------------------------"
+          "----------------\n"
+          "Name                      State           Lease (s)       Latency"
+          " (ms)           \n"
+          "---------------------------------------------------------------"
+          "----------------\n");
+
+  time_t now = time(NULL);
+
+  // the summary shows what is known and never waits on a plug
+  for (Registry::iterator it = plugs.begin(); it != plugs.end(); it++) {
+
+    const Registry::Handle &plug = it->second;
+
+    fprintf(Log::stream, "%-25s %-15s %-15ld %-22ld\n", plug->name.c_str(),
+            plug->breaker != Plug::CLOSED ? "unreachable"
+            : plug->state == Plug::ON     ? "on"
+            : plug->state == Plug::OFF    ? "off"
+                                          : "unknown",
+            plug->expires - now, plug->latency);
+  }
+
+  // plugs without events are asked, so the next summary is current
+  for (Registry::iterator it = plugs.begin(); it != plugs.end(); it++) {
+
+    if (!it->second->evented && it->second->breaker == Plug::CLOSED) {
+
+      it->second->State(soap, [](bool, bool) {});
+    }
+  }
+
+  char interval[54], rescan[54], queue[54], wait[54], requests[54],
+      throttled[54], retries[54], breakers[54];
+  snprintf(interval, sizeof(interval), "%ld s (%ld-%ld s)", poll_interval,
+           POLL_MIN, timers["poll"].begin()->time);
+  snprintf(rescan, sizeof(rescan), "%ld s", rescan_interval);
+  snprintf(queue, sizeof(queue), "%zu queued (max %zu), %zu running, %lu done",
+           executor.depth(), executor.max_depth(), executor.busy(),
+           executor.completed());
+  snprintf(wait, sizeof(wait), "%ld ms average, %ld ms max",
+           executor.wait_avg(), executor.wait_max());
+  snprintf(requests, sizeof(requests),
+           "%lu ok, %lu timeout, %lu failed, %lu fault, %lu invalid",
+           soap.succeeded, soap.timeouts, soap.failures, soap.faults,
+           soap.invalid);
+  snprintf(throttled, sizeof(throttled), "%zu requests waiting, %lu given up",
+           soap.waiting(), soap.throttled);
+  size_t open = 0;
+
+  unsigned long rejected = 0;
+
+  for (Registry::iterator it = plugs.begin(); it != plugs.end(); it++) {
+
+    open += it->second->breaker != Plug::CLOSED;
+
+    rejected += it->second->rejected;
+  }
+
+  snprintf(breakers, sizeof(breakers), "%zu open, %lu requests rejected",
+           open, rejected);
+  snprintf(retries, sizeof(retries),
+           "%lu retried, %zu backing off, %lu superseded", retry.retried,
+           retry.waiting(), superseded);
+
+  fprintf(Log::stream,
+          "---------------------------------------------------------------"
+          "----------------\n"
+          "Poll interval             %-53s\n"
+          "Rescan interval           %-53s\n"
+          "Commands                  %-53s\n"
+          "Command wait              %-53s\n"
+          "Requests                  %-53s\n"
+          "Throttled                 %-53s\n"
+          "Retries                   %-53s\n"
+          "Breakers                  %-53s\n"
+          "---------------------------------------------------------------"
+          "----------------\n",
+          interval, rescan, queue, wait, requests, throttled, retries,
+          breakers);
+}
+
+void WeMo::display_lux() {
+  fprintf(Log::stream,
+          "---------------------------------------------------------------"
+          "----------------\n"
+          "                                 Lux Settings                  "
+          "                \n"
+          "---------------------------------------------------------------"
+          "----------------\n"
+          "On                        %-53d\n"
+          "Off                       %-53d\n"
+          "Controls                  ",
+          lux_on, lux_off);
+
+  int nchars = 0;
+
+  if (lux_control.empty()) {
+
+    nchars += fputc('-', Log::stream);
+  }
+
+  for (std::vector<std::weak_ptr<Plug>>::iterator it = lux_control.begin();
+       it != lux_control.end(); it++) {
+
+    if (Registry::Handle plug = it->lock()) {
+
+      nchars += fprintf(Log::stream, "%s ", plug->name.c_str());
+    }
+  }
+
+  for (int i = 0; i < (53 - nchars); i++) {
+
+    fputc(' ', Log::stream);
+  }
+  fputc('\n', Log::stream);
+
+  fprintf(Log::stream,
+          "---------------------------------------------------------------"
+          "----------------\n");
+}
+
+void WeMo::display_schedules() {
+
+  trigger_t = time(NULL);
+
+  struct tm *s_tm = localtime(&trigger_t);
+  weekday = 1 << s_tm->tm_wday;
+
+  display_schedule("daily");
+
+  Sun sun(latitude, longitude);
+
+  fprintf(Log::stream,
+          "---------------------------------------------------------------"
+          "----------------\n"
+          "                                    Sun                        "
+          "                \n"
+          "---------------------------------------------------------------"
+          "----------------\n"
+          "Latitude                  %-53f\n"
+          "Longitude                 %-53f\n"
+          "Sun rise                  %-53s\n"
+          "Sun set                   %-53s\n"
+          "---------------------------------------------------------------"
+          "----------------\n",
+          latitude, longitude, sun.rise().c_str(), sun.set().c_str());
+
+  if (timers["sun"].size()) {
+    display_schedule("sun");
+  }
+}
+
+void WeMo::display_schedule(const char *schedule) {
+
+  fprintf(Log::stream,
+          "-----------------------------------------------------------"
+          "----"
+          "----------------\n"
+          "                       Registered %s Timers and "
+          "Schedule    "
+          "                \n"
+          "-----------------------------------------------------------"
+          "----"
+          "----------------\n"
+          "Name                      Action          Date and time    "
+          "    "
+          "                \n"
+          "-----------------------------------------------------------"
+          "----"
+          "----------------\n",
+          schedule);
+
+  std::vector<WeMo::Timer> timestamps;
+
+  if (strcmp(schedule, "daily") == 0) {
+
+    timestamps.push_back((WeMo::Timer){
+        .plug = {}, .group = {}, .time = poll_t, .action = "poll"});
+  }
+
+  std::map<std::string, std::vector<WeMo::Timer>>::iterator display =
+      timers.find(schedule);
+  if (display != timers.end()) {
+
+    for (std::vector<WeMo::Timer>::iterator it = display->second.begin();
+         it != display->second.end(); it++) {
+
+      if (it->plug.expired() && it->group.empty()) {
+
+        continue;
+      }
+
+      time_t t = epoch_time(TIME_T(it->time)), wday = TIME_WD(it->time);
+
+      if (trigger_t >= t || (wday && !(weekday & wday))) {
+
+        t = next_weekday(t, wday);
+      }
+
+      timestamps.push_back((WeMo::Timer){.plug = it->plug,
+                                         .group = it->group,
+                                         .time = t,
+                                         .action = it->action});
+    }
+
+    std::sort(timestamps.begin(), timestamps.end(), WeMo::TimerCompare);
+  }
+
+  char date[64];
+
+  for (std::vector<WeMo::Timer>::iterator it = timestamps.begin();
+       it != timestamps.end(); it++) {
+
+    strftime(date, sizeof(date), "%a, %B %d,%Y %H:%M:%S", localtime(&it->time));
+
+    Registry::Handle plug = it->plug.lock();
+
+    std::string name = plug ? plug->name : it->group;
+
+    fprintf(Log::stream, "%-25s %-15s %-37s\n", name.c_str(),
+            it->action.c_str(), date);
+  }
+
+  fprintf(Log::stream,
+          "---------------------------------------------------------------"
+          "----------------\n");
+}
+
+void WeMo::poll() {
+
+  if (!unstable && poll_interval < timers["poll"].begin()->time) {
+
+    poll_interval = std::min(2 * poll_interval, timers["poll"].begin()->time);
+
+    Log::info("Plugs stable, relaxing poll interval to %ld s", poll_interval);
+  }
+
+  unstable = false;
+
+  time_t now = time(NULL);
+
+  poll_t = now + poll_interval;
+
+  for (Registry::iterator it = plugs.begin(); it != plugs.end(); it++) {
+
+    std::weak_ptr<Plug> plug = it->second;
+
+    probe.add(it->second->ip, it->second->port,
+              [this, plug](const std::string &, int port, bool alive) {
+                probed(plug, port, alive);
+              });
+  }
+
+  if (plugs.empty() || rescan_t <= now + 3) {
+
+    rescan_t = now + rescan_interval;
+
+    discover();
+
+    sweep();
+  }
+}
+
+void WeMo::describe(const Registry::Handle &plug) {
+
+  std::weak_ptr<Plug> weak = plug;
+
+  plug->Describe(soap, [this, weak](bool ok) { described(weak, ok); });
+}
+
+void WeMo::described(std::weak_ptr<Plug> weak, bool ok) {
+
+  Registry::Handle plug = weak.lock();
+  if (!plug) {
+
+    return;
+  }
+
+  if (ok) {
+
+    plugs.touch();
+
+    rebind = true;
+
+    return;
+  }
+
+  // without a description a new plug is asked for its name, but only once
+  if (!plug->name.empty() || plug->named) {
+
+    return;
+  }
+
+  plug->named = true;
+
+  plug->Name(soap, "", [this, weak](bool ok) {
+    Registry::Handle plug = weak.lock();
+    if (ok && plug) {
+      plugs.touch();
+      rebind = true;
+    }
+  });
+}
+
+void WeMo::subscribe(const Registry::Handle &plug) {
+
+  std::string local = events.address(plug->ip);
+
+  std::string headers =
+      plug->sid.empty()
+          ? "CALLBACK: <http://" + local + ":" + std::to_string(events.port) +
+                "/>\r\n"
+                "NT: upnp:event\r\n"
+          : "SID: " + plug->sid + "\r\n";
+
+  headers += "TIMEOUT: Second-" + std::to_string(WeMo::SUBSCRIPTION) + "\r\n";
+
+  // retry in a minute unless the subscription succeeds
+  plug->renew = time(NULL) + POLL_MIN;
+
+  if (plug->breaker != Plug::CLOSED) {
+
+    return;
+  }
+
+  std::weak_ptr<Plug> weak = plug;
+
+  soap.http(plug->ip, plug->port, "SUBSCRIBE", "/upnp/event/basicevent1",
+            headers,
+            [this, weak](SOAP::Status status, int, const std::string &head) {
+              Registry::Handle plug = weak.lock();
+              if (plug && (status == SOAP::TIMEOUT || status == SOAP::FAILED)) {
+                plug->Unreachable();
+              }
+              subscribed(weak, status == SOAP::OK, head);
+            });
+}
+
+void WeMo::subscribed(std::weak_ptr<Plug> weak, bool ok,
+                      const std::string &head) {
+
+  Registry::Handle plug = weak.lock();
+  if (!plug) {
+
+    return;
+  }
+
+  std::string sid;
+
+  time_t timeout = WeMo::SUBSCRIPTION;
+
+  std::istringstream iss(head);
+
+  for (std::string line; ok && std::getline(iss, line);) {
+
+    if (0 == strncasecmp(line.c_str(), "SID:", 4)) {
+
+      sid = line.substr(4);
+
+      sid.erase(0, sid.find_first_not_of(" \t"));
+
+      sid.erase(sid.find_last_not_of(" \t\r") + 1);
+    } else if (0 == strncasecmp(line.c_str(), "TIMEOUT:", 8)) {
+
+      const char *second = strcasestr(line.c_str(), "Second-");
+
+      if (second) {
+
+        timeout = strtol(second + 7, NULL, 10);
+      }
+    }
+  }
+
+  if (!ok || sid.empty()) {
+
+    if (!plug->sid.empty()) {
+
+      Log::warn("Lost event subscription of Plug at %s", plug->ip.c_str());
+    }
+
+    plug->sid.clear();
+
+    plug->evented = false;
+
+    return;
+  }
+
+  if (plug->sid != sid) {
+
+    Log::info("Subscribed to events of Plug at %s", plug->ip.c_str());
+
+    plug->sid = sid;
+
+    plug->evented = false;
+  }
+
+  plug->renew = time(NULL) + std::max(timeout / 2, (time_t)30);
+}
+
+bool WeMo::event(const std::string &sid, const std::string &name,
+                 const std::string &value) {
+
+  Registry::Handle plug;
+
+  for (Registry::iterator it = plugs.begin(); it != plugs.end(); it++) {
+
+    if (it->second->sid == sid) {
+
+      plug = it->second;
+
+      break;
+    }
+  }
+
+  if (!plug) {
+
+    return false;
+  }
+
+  int state = Plug::Binary(value);
+
+  if (name == "BinaryState" && state != -1) {
+
+    if (plug->evented && plug->state != state) {
+
+      Log::info("Plug '%s' switched %s", plug->name.c_str(),
+                state == Plug::ON ? "on" : "off");
+    }
+
+    plug->state = state;
+
+    plug->evented = true;
+  }
+
+  return true;
+}
+
+void WeMo::sweep() {
+
+  if (sweeps.empty()) {
+
+    return;
+  }
+
+  if (sweeping) {
+
+    Log::warn("Sweep for Plugs already in progress");
+
+    return;
+  }
+
+  std::vector<std::string> ips;
+
+  for (std::vector<std::string>::iterator it = sweeps.begin();
+       it != sweeps.end(); it++) {
+
+    if (*it == "arp") {
+
+      FILE *fp = fopen("/proc/net/arp", "r");
+      if (!fp) {
+
+        Log::perror("Failed to open '/proc/net/arp'");
+
+        continue;
+      }
+
+      char line[256], ip[16];
+
+      unsigned int flags;
+
+      while (fgets(line, sizeof(line), fp)) {
+
+        if (2 == sscanf(line, "%15s %*s %x", ip, &flags) && (flags & 0x2)) {
+
+          ips.push_back(ip);
+        }
+      }
+
+      fclose(fp);
+
+      continue;
+    }
+
+    char addr[16];
+
+    int prefix = 32;
+
+    struct in_addr net;
+
+    if (sscanf(it->c_str(), "%15[0-9.]/%d", addr, &prefix) < 1 ||
+        1 != inet_pton(AF_INET, addr, &net) || prefix < 16 || prefix > 32) {
+
+      Log::warn("Invalid sweep range '%s' (expecting a.b.c.d/16-32 or arp) "
+                "... ignoring",
+                it->c_str());
+
+      continue;
+    }
+
+    uint32_t size = 1U << (32 - prefix);
+
+    uint32_t first = ntohl(net.s_addr) & ~(size - 1), last = first + size - 1;
+
+    if (size > 2) {
+
+      ++first;
+
+      --last;
+    }
+
+    for (uint32_t h = first; h <= last && h >= first; h++) {
+
+      struct in_addr host = {htonl(h)};
+
+      char ip[INET_ADDRSTRLEN];
+
+      ips.push_back(inet_ntop(AF_INET, &host, ip, sizeof(ip)));
+    }
+  }
+
+  sweep_ips.clear();
+
+  sweep_found = 0;
+
+  gettimeofday(&sweep_started, NULL);
+
+  size_t targets = 0;
+
+  for (std::vector<std::string>::iterator it = ips.begin(); it != ips.end();
+       it++) {
+
+    if (plugs.find_ip(*it)) {
+
+      continue;
+    }
+
+    for (int p = Plug::PORT_FIRST; p <= Plug::PORT_LAST; p++) {
+
+      sweeper.add(*it, p,
+                  [this](const std::string &ip, int port, bool alive) {
+                    if (alive) {
+                      swept(ip, port);
+                    }
+                  });
+
+      ++targets;
+    }
+  }
+
+  Log::info("Sweeping %zu port(s) on %zu address(es) for Plugs", targets,
+            ips.size());
+
+  sweeping = true;
+}
+
+void WeMo::swept(const std::string &ip, int port) {
+
+  if (plugs.find_ip(ip) || !sweep_ips.insert(ip).second) {
+
+    return;
+  }
+
+  Registry::Handle candidate = std::make_shared<Plug>(ip, port);
+
+  ++sweep_describing;
+
+  candidate->Describe(soap, [this, candidate, ip, port](bool ok) {
+    --sweep_describing;
+    if (!ok || candidate->udn.empty() ||
+        candidate->type.find("urn:Belkin:device:") == std::string::npos ||
+        plugs.find_ip(ip)) {
+      return;
+    }
+    Registry::Handle plug = plugs.add(candidate->udn, ip, port);
+    plug->type = candidate->type;
+    plug->name = candidate->name;
+    plug->model = candidate->model;
+    plug->serial = candidate->serial;
+    plug->firmware = candidate->firmware;
+    plug->mac = candidate->mac;
+    plug->described = true;
+    plug->stale = false;
+    extend(plug);
+    Log::info("Found Plug at %s:%d by sweep", ip.c_str(), port);
+    ++churn;
+    ++sweep_found;
+  });
+}
+
+void WeMo::sweep_finish() {
+
+  if (!sweeping || sweeper.busy() || sweep_describing > 0) {
+
+    return;
+  }
+
+  sweeping = false;
+
+  struct timeval now, elapsed;
+  gettimeofday(&now, NULL);
+
+  timersub(&now, &sweep_started, &elapsed);
+
+  Log::info("Sweep finished in %ld ms: found %zu new Plug(s)",
+            elapsed.tv_sec * 1000L + elapsed.tv_usec / 1000L, sweep_found);
+
+  if (sweep_found > 0) {
+
+    plugs.save();
+
+    discovered();
+
+    churned();
+  }
+}
+
+void WeMo::probed(std::weak_ptr<Plug> weak, int port, bool alive) {
+
+  Registry::Handle plug = weak.lock();
+  if (!plug) {
+
+    return;
+  }
+
+  if (alive) {
+
+    if (plug->port != port && plugs.move(plug, plug->ip, port)) {
+
+      ++churn;
+
+      churned();
+    }
+
+    plug->missed = 0;
+
+    plug->Reachable();
+
+    extend(plug);
+
+    return;
+  }
+
+  if (plug->port != port) {
+
+    return;
+  }
+
+  Log::info("Plug '%s' at %s:%d did not answer probe (%dx)", plug->name.c_str(),
+            plug->ip.c_str(), plug->port, ++plug->missed);
+
+  for (int p = Plug::PORT_FIRST; p <= Plug::PORT_LAST; p++) {
+
+    if (p != port) {
+
+      probe.add(plug->ip, p,
+                [this, weak](const std::string &, int port, bool alive) {
+                  if (alive) {
+                    probed(weak, port, alive);
+                  }
+                });
+    }
+  }
+
+  if (plug->missed >= WeMo::MISSES) {
+
+    Log::info("De-registered Plug at %s", plug->ip.c_str());
+
+    plugs.erase(plug);
+
+    ++churn;
+
+    churned();
+  }
+}
+
+void WeMo::extend(const Registry::Handle &plug) {
 
-  Sun *sun = nullptr;
+  plug->seen = time(NULL);
 
-  for (std::vector<Plug>::iterator it = this->plugs.begin();
-       it != this->plugs.end(); it++) {
+  // a plug that only answers probes must outlive the probes that can miss it
+  plug->expires =
+      plug->seen + std::max(plug->lease, WeMo::MISSES * poll_interval);
 
-    name = it->Name();
+  plugs.touch();
+}
 
-    if (settings.find(name.c_str()) != settings.end()) {
+void WeMo::neighbor(const std::string &mac, const std::string &ip,
+                    bool present) {
 
-      if (settings[name].find("sun") != settings[name].end()) {
+  Registry::Handle plug;
+  if (!present || !(plug = plugs.find_mac(mac)) || plug->ip == ip) {
 
-        if (settings[name]["sun"] == "true") {
+    return;
+  }
 
-          if (!sun) {
+  if (plugs.move(plug, ip, plug->port)) {
 
-            sun = new Sun(latitude, longitude);
-          }
+    ++churn;
 
-          char k[8], wday_val[16];
+    churned();
 
-          int time_val;
+    plugs.save();
+  }
+}
 
-          if (settings[name].find("rise") != settings[name].end()) {
+int WeMo::fds(fd_set *fd_in) const {
 
-            if ((t = parse_time(sun->rise().c_str())) != -1) {
+  int fd_max = Discover::fds(fd_in);
 
-              std::istringstream iss(settings[name]["rise"]);
+  if (probe.fd_epoll != -1) {
 
-              for (std::string token; std::getline(iss, token, ',');) {
+    FD_SET(probe.fd_epoll, fd_in);
 
-                int nval = sscanf(token.c_str(), "%7[^:]:%d%%%15s", k,
-                                  &time_val, wday_val);
+    fd_max = std::max(fd_max, probe.fd_epoll);
+  }
 
-                if (nval > 1 && nval < 4) {
+  if (events.fd_epoll != -1) {
 
-                  time_t wday = nval > 2 ? parse_wday(wday_val) : 0;
+    FD_SET(events.fd_epoll, fd_in);
 
-                  if (strcmp(k, "on") == 0) {
+    fd_max = std::max(fd_max, events.fd_epoll);
+  }
 
-                    this->timers["sun"].push_back(
-                        (WeMo::Timer){.plug = &(*it),
-                                      .time = (t + time_val) | wday,
-                                      .action = "on"});
-                  } else if (strcmp(k, "off") == 0) {
+  if (soap.fd_epoll != -1) {
 
-                    this->timers["sun"].push_back(
-                        (WeMo::Timer){.plug = &(*it),
-                                      .time = (t + time_val) | wday,
-                                      .action = "off"});
-                  } else {
+    FD_SET(soap.fd_epoll, fd_in);
 
-                    Log::warn("Invalid parameter in sun rise "
-                              "options '%s' ... "
-                              "ignoring\n",
-                              k);
-                  }
-                } else {
+    fd_max = std::max(fd_max, soap.fd_epoll);
+  }
 
-                  Log::warn("Failed to parse sun rise "
-                            "options: '%s' ... ignoring\n",
-                            token.c_str());
-                }
-              }
-            } else {
+  if (sweeper.fd_epoll != -1) {
 
-              Log::warn("Failed to parse sun rise for '%s' ... ignoring",
-                        name.c_str());
-            }
-          }
+    FD_SET(sweeper.fd_epoll, fd_in);
 
-          if (settings[name].find("set") != settings[name].end()) {
+    fd_max = std::max(fd_max, sweeper.fd_epoll);
+  }
 
-            if ((t = parse_time(sun->set().c_str())) != -1) {
+  if (neighbors.fd != -1) {
 
-              std::istringstream iss(settings[name]["set"]);
+    FD_SET(neighbors.fd, fd_in);
 
-              for (std::string token; std::getline(iss, token, ',');) {
+    fd_max = std::max(fd_max, neighbors.fd);
+  }
 
-                int nval = sscanf(token.c_str(), "%7[^:]:%d%%%15s", k,
-                                  &time_val, wday_val);
+  return fd_max;
+}
 
-                if (nval > 1 && nval < 4) {
+void WeMo::message(const fd_set *fd_in) {
 
-                  time_t wday = nval > 2 ? parse_wday(wday_val) : 0;
+  Discover::message(fd_in);
 
-                  if (strcmp(k, "on") == 0) {
+  if (probe.fd_epoll != -1 && FD_ISSET(probe.fd_epoll, fd_in)) {
 
-                    this->timers["sun"].push_back(
-                        (WeMo::Timer){.plug = &(*it),
-                                      .time = (t + time_val) | wday,
-                                      .action = "on"});
-                  } else if (strcmp(k, "off") == 0) {
+    probe.handler();
+  }
 
-                    this->timers["sun"].push_back(
-                        (WeMo::Timer){.plug = &(*it),
-                                      .time = (t + time_val) | wday,
-                                      .action = "off"});
-                  } else {
+  // a SUBSCRIBE reply carries the SID its first NOTIFY is matched against
+  if (soap.fd_epoll != -1 && FD_ISSET(soap.fd_epoll, fd_in)) {
 
-                    Log::warn("Invalid parameter in sun set options '%s' ... "
-                              "ignoring\n",
-                              k);
-                  }
-                } else {
+    soap.handler();
+  }
 
-                  Log::warn(
-                      "Failed to parse sun set options: '%s' ... ignoring\n",
-                      token.c_str());
-                }
-              }
-            } else {
+  if (events.fd_epoll != -1 && FD_ISSET(events.fd_epoll, fd_in)) {
 
-              Log::warn("Failed to parse sun set for '%s' ... ignoring",
-                        name.c_str());
-            }
-          }
-        }
-      }
+    events.handler([this](const std::string &sid, const std::string &name,
+                          const std::string &value) {
+      return event(sid, name, value);
+    });
+  }
 
-      if (settings[name].find("daily") != settings[name].end()) {
+  if (sweeper.fd_epoll != -1 && FD_ISSET(sweeper.fd_epoll, fd_in)) {
 
-        if (settings[name]["daily"] == "true") {
+    sweeper.handler();
 
-          if (settings[name].find("ontimes") != settings[name].end()) {
+    sweep_finish();
+  }
 
-            std::istringstream iss(settings[name]["ontimes"]);
+  if (neighbors.fd != -1 && FD_ISSET(neighbors.fd, fd_in)) {
 
-            for (std::string token; std::getline(iss, token, ',');) {
+    neighbors.handler([this](const std::string &mac, const std::string &ip,
+                             bool present) { neighbor(mac, ip, present); });
+  }
+}
 
-              if ((t = parse_time(token.c_str())) != -1) {
+struct timeval *WeMo::timeout(struct timeval *tv) const {
 
-                this->timers["daily"].push_back(
-                    (WeMo::Timer){.plug = &(*it), .time = t, .action = "on"});
-              } else {
+  struct timeval t, u, v;
 
-                Log::warn("Failed to parse on time for '%s' ... ignoring",
-                          name.c_str());
-              }
-            }
-          }
+  struct timeval *d = Discover::timeout(tv), *p = probe.timeout(&t),
+                 *q = sweeper.timeout(&u), *r = soap.timeout(&v);
 
-          if (settings[name].find("offtimes") != settings[name].end()) {
+  if (q && (!p || timercmp(q, p, <))) {
 
-            std::istringstream iss(settings[name]["offtimes"]);
+    p = q;
+  }
 
-            for (std::string token; std::getline(iss, token, ',');) {
+  if (r && (!p || timercmp(r, p, <))) {
 
-              if ((t = parse_time(token.c_str())) != -1) {
+    p = r;
+  }
 
-                this->timers["daily"].push_back(
-                    (WeMo::Timer){.plug = &(*it), .time = t, .action = "off"});
-              } else {
+  struct timeval y, *b = retry.timeout(&y);
 
-                Log::warn("Failed to parse off time for '%s' ... ignoring",
-                          name.c_str());
-              }
-            }
-          }
-        }
-      }
-    }
-  }
+  if (b && (!p || timercmp(b, p, <))) {
 
-  if (sun) {
+    t = y;
 
-    delete sun;
+    p = &t;
   }
 
-  lux_control.clear();
+  struct timeval z, *e = events.timeout(&z);
 
-  lux_on = lux_off = -1;
+  if (e && (!p || timercmp(e, p, <))) {
 
-  if (settings.find("serial") != settings.end()) {
+    t = z;
 
-    if (settings["serial"].find("onlux") != settings["serial"].end()) {
+    p = &t;
+  }
 
-      lux_on = strtol(settings["serial"]["onlux"].c_str(), nullptr, 10);
-    }
+  struct timeval x, now;
 
-    if (settings["serial"].find("offlux") != settings["serial"].end()) {
+  gettimeofday(&now, NULL);
 
-      lux_off = strtol(settings["serial"]["offlux"].c_str(), nullptr, 10);
+  for (std::vector<std::shared_ptr<WeMo::Dispatch>>::const_iterator it =
+           dispatches.begin();
+       it != dispatches.end(); it++) {
+
+    if (!timercmp(&(*it)->deadline, &now, >)) {
+
+      timerclear(&x);
+    } else {
+
+      timersub(&(*it)->deadline, &now, &x);
     }
 
-    if (settings["serial"].find("controls") != settings["serial"].end()) {
+    if (!p || timercmp(&x, p, <)) {
 
-      std::istringstream iss(settings["serial"]["controls"]);
+      v = x;
 
-      for (std::string token; std::getline(iss, token, ',');) {
+      p = &v;
+    }
+  }
 
-        for (std::vector<Plug>::iterator it = this->plugs.begin();
-             it != this->plugs.end(); it++) {
+  time_t renew = 0;
 
-          if (it->name == token) {
+  for (Registry::const_iterator it = plugs.begin();
+       subscribing && it != plugs.end(); it++) {
 
-            lux_control.push_back(&(*it));
+    if (renew == 0 || it->second->renew < renew) {
 
-            break;
-          }
-        }
-      }
+      renew = it->second->renew;
     }
   }
 
-  return true;
-}
+  for (Registry::const_iterator it = plugs.begin(); it != plugs.end(); it++) {
 
-void WeMo::check_lux(uint32_t lux) {
+    if (it->second->breaker == Plug::OPEN &&
+        (renew == 0 || it->second->reopen < renew)) {
 
-  static uint32_t lux_prev = 0;
+      renew = it->second->reopen;
+    }
+  }
 
-  if (lux < lux_on && lux_prev >= lux_on) {
+  if (renew != 0) {
+
+    struct timeval w = {std::max(renew - time(NULL), (time_t)0), 0};
 
-    for (std::vector<Plug *>::iterator it = lux_control.begin();
-         it != lux_control.end(); it++) {
+    if (!p || timercmp(&w, p, <)) {
 
-      Log::info("Sending 'ON' to %s", (*it)->name.c_str());
+      u = w;
 
-      std::thread(&Plug::On, *it).detach();
+      p = &u;
     }
-  } else if (lux > lux_off && lux_prev <= lux_off) {
+  }
 
-    for (std::vector<Plug *>::iterator it = lux_control.begin();
-         it != lux_control.end(); it++) {
+  if (p && (!d || timercmp(p, d, <))) {
 
-      Log::info("Sending 'OFF' to %s", (*it)->name.c_str());
+    *tv = *p;
 
-      std::thread(&Plug::Off, *it).detach();
-    }
+    return tv;
   }
 
-  lux_prev = lux;
+  return d;
 }
 
-void WeMo::display_plugs() {
-  fprintf(Log::stream,
-          "---------------------------------------------------------------"
-          "----------------\n"
-          "                                   Plugs                       "
-          "                \n"
-          "---------------------------------------------------------------"
-          "----------------\n"
-          "Name                      State           Lost                 "
-          "                \n"
-          "---------------------------------------------------------------"
-          "----------------\n");
+bool WeMo::expire() {
 
-  for (std::vector<Plug>::iterator it = plugs.begin(); it != plugs.end();
-       it++) {
+  probe.expire();
 
-    fprintf(Log::stream, "%-25s %-15s %-38d\n", it->name.c_str(),
-            it->lost      ? "?"
-            : it->State() ? "on"
-                          : "off",
-            it->lost);
-  }
+  sweeper.expire();
 
-  fprintf(Log::stream,
-          "---------------------------------------------------------------"
-          "----------------\n");
-}
+  sweep_finish();
 
-void WeMo::display_lux() {
-  fprintf(Log::stream,
-          "---------------------------------------------------------------"
-          "----------------\n"
-          "                                 Lux Settings                  "
-          "                \n"
-          "---------------------------------------------------------------"
-          "----------------\n"
-          "On                        %-53d\n"
-          "Off                       %-53d\n"
-          "Controls                  ",
-          lux_on, lux_off);
+  soap.expire();
 
-  int nchars = 0;
+  retry.expire();
 
-  if (lux_control.empty()) {
+  events.expire();
 
-    nchars += fputc('-', Log::stream);
-  }
+  struct timeval tv;
 
-  for (std::vector<Plug *>::iterator it = lux_control.begin();
-       it != lux_control.end(); it++) {
+  gettimeofday(&tv, NULL);
+
+  std::vector<std::shared_ptr<WeMo::Dispatch>> late;
+
+  for (std::vector<std::shared_ptr<WeMo::Dispatch>>::iterator it =
+           dispatches.begin();
+       it != dispatches.end(); it++) {
 
-    nchars += fprintf(Log::stream, "%s ", (*it)->name.c_str());
+    if (!timercmp(&tv, &(*it)->deadline, <)) {
+
+      late.push_back(*it);
+    }
   }
 
-  for (int i = 0; i < (53 - nchars); i++) {
+  for (std::vector<std::shared_ptr<WeMo::Dispatch>>::iterator it =
+           late.begin();
+       it != late.end(); it++) {
 
-    fputc(' ', Log::stream);
+    report(*it);
   }
-  fputc('\n', Log::stream);
 
-  fprintf(Log::stream,
-          "---------------------------------------------------------------"
-          "----------------\n");
-}
+  time_t now = time(NULL);
 
-void WeMo::display_schedules() {
+  for (Registry::iterator it = plugs.begin(); it != plugs.end(); it++) {
 
-  trigger_t = time(NULL);
+    Registry::Handle plug = it->second;
 
-  struct tm *s_tm = localtime(&trigger_t);
-  weekday = 1 << s_tm->tm_wday;
+    if (plug->breaker != Plug::OPEN || plug->reopen > now) {
 
-  display_schedule("daily");
+      continue;
+    }
 
-  Sun sun(latitude, longitude);
+    // a cheap connect decides whether the plug is back
+    plug->breaker = Plug::HALF_OPEN;
 
-  fprintf(Log::stream,
-          "---------------------------------------------------------------"
-          "----------------\n"
-          "                                    Sun                        "
-          "                \n"
-          "---------------------------------------------------------------"
-          "----------------\n"
-          "Latitude                  %-53f\n"
-          "Longitude                 %-53f\n"
-          "Sun rise                  %-53s\n"
-          "Sun set                   %-53s\n"
-          "---------------------------------------------------------------"
-          "----------------\n",
-          latitude, longitude, sun.rise().c_str(), sun.set().c_str());
+    std::weak_ptr<Plug> weak = plug;
 
-  if (timers["sun"].size()) {
-    display_schedule("sun");
+    probe.add(plug->ip, plug->port,
+              [this, weak](const std::string &, int port, bool alive) {
+                Registry::Handle plug = weak.lock();
+                if (!plug || plug->breaker != Plug::HALF_OPEN) {
+                  return;
+                }
+                if (alive) {
+                  probed(weak, port, alive);
+                } else {
+                  plug->Trip();
+                }
+              });
   }
-}
 
-void WeMo::display_schedule(const char *schedule) {
+  for (Registry::iterator it = plugs.begin(); subscribing && it != plugs.end();
+       it++) {
 
-  fprintf(Log::stream,
-          "-----------------------------------------------------------"
-          "----"
-          "----------------\n"
-          "                       Registered %s Timers and "
-          "Schedule    "
-          "                \n"
-          "-----------------------------------------------------------"
-          "----"
-          "----------------\n"
-          "Name                      Action          Date and time    "
-          "    "
-          "                \n"
-          "-----------------------------------------------------------"
-          "----"
-          "----------------\n",
-          schedule);
+    if (it->second->renew <= now) {
 
-  std::vector<WeMo::Timer> timestamps;
+      subscribe(it->second);
+    }
+  }
 
-  if (strcmp(schedule, "daily") == 0) {
+  // descriptions and names arrive one by one, schedules are rebuilt once
+  if (rebind) {
 
-    timestamps.push_back(
-        (WeMo::Timer){.plug = nullptr, .time = poll_t, .action = "poll"});
-  }
+    rebind = false;
 
-  std::map<std::string, std::vector<WeMo::Timer>>::iterator display =
-      timers.find(schedule);
-  if (display != timers.end()) {
+    discovered();
+  }
 
-    for (std::vector<WeMo::Timer>::iterator it = display->second.begin();
-         it != display->second.end(); it++) {
+  return Discover::expire();
+}
 
-      time_t t = epoch_time(TIME_T(it->time)), wday = TIME_WD(it->time);
+void WeMo::tighten(const char *reason) {
 
-      if (trigger_t >= t || (wday && !(weekday & wday))) {
+  unstable = true;
 
-        t = next_weekday(t, wday);
-      }
+  if (poll_interval > POLL_MIN) {
 
-      timestamps.push_back(
-          (WeMo::Timer){.plug = it->plug, .time = t, .action = it->action});
-    }
+    Log::info("%s, tightening poll interval to %ld s", reason, POLL_MIN);
 
-    std::sort(timestamps.begin(), timestamps.end(), WeMo::TimerCompare);
+    poll_interval = POLL_MIN;
   }
 
-  char date[64];
-
-  for (std::vector<WeMo::Timer>::iterator it = timestamps.begin();
-       it != timestamps.end(); it++) {
+  // the next poll is brought forward at once, not at the next alarm
+  if (poll_t > time(NULL) + poll_interval) {
 
-    strftime(date, sizeof(date), "%a, %B %d,%Y %H:%M:%S", localtime(&it->time));
+    poll_t = time(NULL) + poll_interval;
 
-    fprintf(Log::stream, "%-25s %-15s %-37s\n",
-            it->plug ? it->plug->name.c_str() : "", it->action.c_str(), date);
+    arm();
   }
-
-  fprintf(Log::stream,
-          "---------------------------------------------------------------"
-          "----------------\n");
 }
 
-void WeMo::poll() {
+void WeMo::churned() {
 
-  std::vector<Plug> old = std::move(plugs);
+  tighten("Plugs changed");
+}
 
-  discover();
+void WeMo::discovered() {
 
-  for (std::vector<Plug>::iterator it = old.begin(); it != old.end(); it++) {
+  // schedules bind to plugs by name, so only a new, renamed or replaced
+  // plug needs them rebuilt
+  size_t named = 0;
+  for (Registry::iterator it = plugs.begin(); it != plugs.end(); it++) {
 
-    std::vector<Plug>::iterator p =
-        std::find_if(plugs.begin(), plugs.end(),
-                     [&it](const Plug &p) { return it->ip == p.ip; });
+    named += !it->second->name.empty();
+  }
 
-    if (p == plugs.end()) {
+  bool changed = named != roster.size();
 
-      Log::info("Lost Plug at %s (%dx)", it->ip.c_str(), ++it->lost);
+  for (std::vector<std::pair<std::weak_ptr<Plug>, std::string>>::iterator it =
+           roster.begin();
+       !changed && it != roster.end(); it++) {
 
-      if (it->lost < 5) {
+    Registry::Handle plug = it->first.lock();
 
-        plugs.push_back(*it);
-      } else {
+    changed = !plug || plug->name != it->second;
+  }
 
-        Log::info("De-registered Plug at %s", it->ip.c_str());
-      }
-    } else {
+  if (changed) {
 
-      p->lost = 0;
-    }
+    load_settings(*settings);
   }
 
-  load_settings(*settings);
-
-  offset_t = time(NULL) - trigger_t;
+  arm();
 }
 
 void WeMo::check_schedule(const char *schedule) {
@@ -511,19 +1804,21 @@ void WeMo::check_schedule(const char *schedule) {
 
       time_t t = epoch_time(TIME_T(it->time)), wday = TIME_WD(it->time);
 
-      if ((!wday || (wday && (weekday & wday))) && t >= trigger_t &&
-          t <= (trigger_t + offset_t + 3)) {
+      Registry::Handle plug = it->plug.lock();
+      if (!plug && it->group.empty()) {
 
-        if (it->action == "on") {
+        continue;
+      }
 
-          Log::info("Sending 'ON' to %s", it->plug->name.c_str());
+      if ((!wday || (wday && (weekday & wday))) && t >= trigger_t &&
+          t <= (trigger_t + 3)) {
 
-          std::thread(&Plug::On, it->plug).detach();
-        } else if (it->action == "off") {
+        if (plug) {
 
-          Log::info("Sending 'OFF' to %s", it->plug->name.c_str());
+          command(plug, it->action, t);
+        } else {
 
-          std::thread(&Plug::Off, it->plug).detach();
+          dispatch(it->group, groups[it->group], it->action, t);
         }
 
         t = next_weekday(t, wday);
@@ -542,8 +1837,41 @@ void WeMo::check_schedule(const char *schedule) {
   }
 }
 
+void WeMo::upcoming(const char *schedule) {
+
+  std::map<std::string, std::vector<WeMo::Timer>>::iterator check =
+      timers.find(schedule);
+  if (check == timers.end()) {
+
+    return;
+  }
+
+  for (std::vector<WeMo::Timer>::iterator it = check->second.begin();
+       it != check->second.end(); it++) {
+
+    if (it->plug.expired() && it->group.empty()) {
+
+      continue;
+    }
+
+    time_t t = epoch_time(TIME_T(it->time)), wday = TIME_WD(it->time);
+
+    if (trigger_t >= t || (wday && !(weekday & wday))) {
+
+      t = next_weekday(t, wday);
+    }
+
+    if (t < nearest_t) {
+
+      nearest_t = t;
+    }
+  }
+}
+
 void WeMo::rescan() {
 
+  rescan_t = 0;
+
   poll_t = time(NULL);
 
   check_timers();
@@ -571,7 +1899,6 @@ int WeMo::check_timers() {
     return errno;
   }
 
-  offset_t = 0;
   if (poll_t <= (trigger_t + 3)) {
 
     poll();
@@ -585,6 +1912,29 @@ int WeMo::check_timers() {
 
   check_schedule("sun");
 
+  return set_timer();
+}
+
+int WeMo::arm() {
+
+  trigger_t = time(NULL);
+
+  struct tm *s_tm = localtime(&trigger_t);
+  weekday = 1 << s_tm->tm_wday;
+
+  nearest_t = std::max(poll_t, trigger_t + 1);
+
+  upcoming("daily");
+
+  upcoming("sun");
+
+  return set_timer();
+}
+
+int WeMo::set_timer() {
+
+  struct timeval t_val;
+
   char date[64];
   strftime(date, sizeof(date), "%a, %B %d, %Y at %H:%M:%S",
            localtime(&nearest_t));
@@ -599,6 +1949,10 @@ int WeMo::check_timers() {
   }
 
   itimer.it_value = {nearest_t - t_val.tv_sec - 1, 1000000 - t_val.tv_usec};
+  if (itimer.it_value.tv_usec == 1000000) {
+
+    itimer.it_value = {nearest_t - t_val.tv_sec, 0};
+  }
   if (-1 == setitimer(ITIMER_REAL, &itimer, NULL)) {
 
     Log::perror("Failed to set timer");
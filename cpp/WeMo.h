@@ -18,11 +18,19 @@
 
 #include <algorithm>
 #include <map>
-#include <thread>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "Discover.h"
+#include "Events.h"
+#include "Executor.h"
 #include "Log.h"
+#include "Neighbor.h"
+#include "Probe.h"
+#include "Retry.h"
+#include "SOAP.h"
 #include "Settings.h"
 #include "Sun.h"
 
@@ -35,11 +43,32 @@ class WeMo : public Discover {
 
 public:
   typedef struct {
-    Plug *plug;
+    const char *key;
+    const char *operation;
+    long ms;
+  } Timeout;
+
+  typedef struct {
+    std::weak_ptr<Plug> plug;
+    std::string group;
     time_t time;
     std::string action;
   } Timer;
 
+  enum Result { OK, FAILED, SUPERSEDED };
+
+  typedef std::function<void(WeMo::Result result)> Sent;
+
+  typedef struct {
+    std::string group;
+    std::string action;
+    struct timeval started;
+    struct timeval deadline;
+    size_t pending;
+    bool reported;
+    std::vector<std::pair<std::string, const char *>> results;
+  } Dispatch;
+
   inline static bool TimerCompare(WeMo::Timer &a, WeMo::Timer &b) {
 
     return (a.time < b.time);
@@ -56,6 +85,11 @@ public:
 
   void rescan();
 
+  int fds(fd_set *fd_in) const;
+  void message(const fd_set *fd_in);
+  struct timeval *timeout(struct timeval *tv) const;
+  bool expire();
+
   void display_plugs();
   void display_lux();
   void display_schedules();
@@ -65,22 +99,105 @@ private:
   time_t parse_wday(const char *str);
   time_t epoch_time(time_t t);
   time_t next_weekday(time_t t, time_t wday);
+  void schedule(const Settings &settings, const std::string &section,
+                std::weak_ptr<Plug> plug, const std::string &group, Sun *&sun);
   void check_schedule(const char *schedule);
+  void upcoming(const char *schedule);
+  int arm();
+  int set_timer();
+  void command(const Registry::Handle &plug, const std::string &action,
+               time_t scheduled);
+  void send(const Registry::Handle &plug, const std::string &action,
+            WeMo::Sent done, time_t scheduled);
+  void attempt(const Registry::Handle &plug, const std::string &action, int n,
+               unsigned long sequence, const std::string &key,
+               time_t scheduled, WeMo::Sent done, Executor::Finished finished);
+  void dispatch(const std::string &group,
+                const std::vector<std::weak_ptr<Plug>> &members,
+                const std::string &action, time_t scheduled);
+  void report(const std::shared_ptr<WeMo::Dispatch> &d);
   void display_schedule(const char *schedule);
 
   void poll();
+  void probed(std::weak_ptr<Plug> plug, int port, bool alive);
+  void extend(const Registry::Handle &plug);
+  void neighbor(const std::string &mac, const std::string &ip, bool present);
+  void describe(const Registry::Handle &plug) override;
+  void described(std::weak_ptr<Plug> plug, bool ok);
+  void subscribe(const Registry::Handle &plug);
+  void subscribed(std::weak_ptr<Plug> plug, bool ok, const std::string &head);
+  bool event(const std::string &sid, const std::string &name,
+             const std::string &value);
+  void sweep();
+  void swept(const std::string &ip, int port);
+  void sweep_finish();
+  void tighten(const char *reason);
+  void discovered() override;
+  void churned() override;
 
   const Settings *settings;
 
-  std::vector<Plug *> lux_control;
+  std::vector<std::weak_ptr<Plug>> lux_control;
+  std::map<std::string, std::vector<std::weak_ptr<Plug>>> groups;
   std::map<std::string, std::vector<WeMo::Timer>> timers;
+  std::vector<std::pair<std::weak_ptr<Plug>, std::string>> roster;
 
   struct itimerval itimer;
 
   time_t nearest_t;
-  time_t poll_t;
+  static const time_t POLL_MIN = 60;
+
+  static const int MISSES = 3;
+
+  Probe probe;
+
+  SOAP soap;
+
+  Executor executor;
+
+  Retry retry;
+
+  unsigned long superseded = 0;
+
+  Events events;
+
+  bool subscribing = true;
+
+  static const time_t SUBSCRIPTION = 600;
+
+  static const WeMo::Timeout TIMEOUTS[];
+
+  std::vector<std::shared_ptr<WeMo::Dispatch>> dispatches;
+
+  long group_ms = 5000;
+
+  Neighbor neighbors;
+
+  Probe sweeper{512, 250};
+
+  std::vector<std::string> sweeps;
+
+  std::unordered_set<std::string> sweep_ips;
+
+  struct timeval sweep_started = {};
+
+  bool sweeping = false;
+
+  size_t sweep_found = 0;
+
+  size_t sweep_describing = 0;
+
+  time_t poll_t = 0;
+  time_t poll_interval = POLL_MIN;
+
+  time_t rescan_t = 0;
+  time_t rescan_interval = 3600;
+
+  bool unstable = false;
+
+  bool rebind = false;
+
   time_t trigger_t;
-  time_t offset_t;
   time_t weekday;
 
   float latitude;
@@ -0,0 +1,259 @@
+/**
+ *  @file   allocations.cpp
+ *  @brief  Counts heap allocations on the SOAP request path
+ *  @author KrizTioaN (christiaanboersma@hotmail.com)
+ *  @date   2026-10-17
+ *  @note   BSD-3 licensed
+ *
+ *  Compile and run with:
+ *    make bench
+ *
+ *  Drives GetBinaryState requests against an in-process plug over loopback
+ *  and fails when the steady state allocates.
+ *
+ ***********************************************/
+
+#include "SOAP.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <sys/select.h>
+
+static unsigned long allocations = 0;
+
+void *operator new(size_t size) {
+
+  ++allocations;
+
+  void *p = malloc(size ? size : 1);
+  if (p == NULL) {
+
+    throw std::bad_alloc();
+  }
+
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static const int WARMUP = 1000;
+static const int COUNT = 100000;
+static const int DEPTH = 2;
+
+static const int CONNECTIONS = 16;
+
+#define BODY                                                                   \
+  "<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" "         \
+  "s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\"><s:Body>"     \
+  "<u:GetBinaryStateResponse xmlns:u=\"urn:Belkin:service:basicevent:1\">"     \
+  "<BinaryState>1</BinaryState></u:GetBinaryStateResponse></s:Body>"           \
+  "</s:Envelope>"
+
+typedef struct {
+  int fd;
+  char buff[4096];
+  size_t used;
+} Connection;
+
+static char reply[512];
+static int length_reply;
+
+static void serve(Connection *conn) {
+
+  ssize_t bytes = recv(conn->fd, conn->buff + conn->used,
+                       sizeof(conn->buff) - conn->used - 1, 0);
+  if (bytes <= 0) {
+
+    close(conn->fd);
+
+    conn->fd = -1;
+
+    return;
+  }
+
+  conn->used += bytes;
+
+  conn->buff[conn->used] = '\0';
+
+  char *eoh;
+  while ((eoh = strstr(conn->buff, "\r\n\r\n")) != NULL) {
+
+    const char *cl = strcasestr(conn->buff, "Content-Length:");
+
+    size_t size = eoh + 4 - conn->buff + (cl ? strtoul(cl + 15, NULL, 10) : 0);
+    if (conn->used < size) {
+
+      return;
+    }
+
+    if (length_reply != send(conn->fd, reply, length_reply, MSG_NOSIGNAL)) {
+
+      perror("Failed to reply");
+
+      exit(EXIT_FAILURE);
+    }
+
+    memmove(conn->buff, conn->buff + size, conn->used - size + 1);
+
+    conn->used -= size;
+  }
+}
+
+int main() {
+
+  length_reply =
+      snprintf(reply, sizeof(reply),
+               "HTTP/1.1 200 OK\r\nContent-Type: text/xml; charset=\"utf-8\"\r\n"
+               "Connection: keep-alive\r\nContent-Length: %zu\r\n\r\n%s",
+               sizeof(BODY) - 1, BODY);
+
+  struct sockaddr_in addr = {};
+
+  socklen_t len = sizeof(addr);
+
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  int fd_listen = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+  if (fd_listen == -1 ||
+      -1 == bind(fd_listen, (struct sockaddr *)&addr, sizeof(addr)) ||
+      -1 == listen(fd_listen, CONNECTIONS) ||
+      -1 == getsockname(fd_listen, (struct sockaddr *)&addr, &len)) {
+
+    perror("Failed to set up the plug");
+
+    return EXIT_FAILURE;
+  }
+
+  Connection conns[CONNECTIONS];
+
+  for (int i = 0; i < CONNECTIONS; i++) {
+
+    conns[i].fd = -1;
+  }
+
+  struct sockaddr_in remote;
+
+  SOAP::resolve("127.0.0.1", ntohs(addr.sin_port), &remote);
+
+  SOAP soap;
+
+  unsigned long issued = 0, completed = 0, failed = 0, counted = 0;
+
+  const unsigned long total = WARMUP + COUNT;
+
+  struct timeval start, stop;
+
+  while (completed < total) {
+
+    while (issued < total && issued - completed < DEPTH) {
+
+      // the first requests grow the pools, the rest should reuse them
+      if (issued == WARMUP) {
+
+        counted = allocations;
+
+        gettimeofday(&start, NULL);
+      }
+
+      ++issued;
+
+      soap.request(
+          remote, SOAP::GetBinaryState, "",
+          [&completed, &failed](SOAP::Status status, int,
+                                const std::string &value) {
+            if (status != SOAP::OK || value != "1") {
+              ++failed;
+            }
+            ++completed;
+          },
+          false);
+    }
+
+    fd_set fd_in;
+
+    FD_ZERO(&fd_in);
+
+    FD_SET(fd_listen, &fd_in);
+
+    FD_SET(soap.fd_epoll, &fd_in);
+
+    int fd_max = std::max(fd_listen, soap.fd_epoll);
+
+    for (int i = 0; i < CONNECTIONS; i++) {
+
+      if (conns[i].fd != -1) {
+
+        FD_SET(conns[i].fd, &fd_in);
+
+        fd_max = std::max(fd_max, conns[i].fd);
+      }
+    }
+
+    struct timeval tv;
+
+    if (-1 == select(fd_max + 1, &fd_in, NULL, NULL, soap.timeout(&tv))) {
+
+      perror("Failed to wait");
+
+      return EXIT_FAILURE;
+    }
+
+    if (FD_ISSET(fd_listen, &fd_in)) {
+
+      int fd = accept4(fd_listen, NULL, NULL, SOCK_CLOEXEC);
+
+      for (int i = 0; fd != -1 && i < CONNECTIONS; i++) {
+
+        if (conns[i].fd == -1) {
+
+          conns[i].fd = fd;
+
+          conns[i].used = 0;
+
+          fd = -1;
+        }
+      }
+
+      if (fd != -1) {
+
+        close(fd);
+      }
+    }
+
+    for (int i = 0; i < CONNECTIONS; i++) {
+
+      if (conns[i].fd != -1 && FD_ISSET(conns[i].fd, &fd_in)) {
+
+        serve(&conns[i]);
+      }
+    }
+
+    if (FD_ISSET(soap.fd_epoll, &fd_in)) {
+
+      soap.handler();
+    }
+
+    soap.expire();
+  }
+
+  gettimeofday(&stop, NULL);
+
+  counted = allocations - counted;
+
+  timersub(&stop, &start, &stop);
+
+  double us = stop.tv_sec * 1e6 + stop.tv_usec;
+
+  printf("%d requests, %lu failed, %lu allocations (%.3f per request), "
+         "%.1f us per request\n",
+         COUNT, failed, counted, (double)counted / COUNT, us / COUNT);
+
+  close(fd_listen);
+
+  return failed == 0 && counted == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -62,16 +62,17 @@ int main(int argc, char *argv[], char **envp) {
 
   fd_set fd_in;
 
+  struct timeval tv;
+
   int finished = wemo.check_timers();
 
   while (0 == finished) {
 
     FD_ZERO(&fd_in);
     FD_SET(settings.fd_inotify, &fd_in);
-    FD_SET(wemo.fd_socket, &fd_in);
     FD_SET(fd_signal, &fd_in);
-    int fd_max =
-        std::max(std::max(settings.fd_inotify, wemo.fd_socket), fd_signal);
+    int fd_max = std::max(std::max(settings.fd_inotify, wemo.fds(&fd_in)),
+                          fd_signal);
     int fd_sensor = sensor.serial.filedescriptor();
     if (fd_sensor != -1) {
 
@@ -80,7 +81,7 @@ int main(int argc, char *argv[], char **envp) {
       fd_max = std::max(fd_max, fd_sensor);
     }
 
-    if (-1 == select(fd_max + 1, &fd_in, nullptr, nullptr, nullptr)) {
+    if (-1 == select(fd_max + 1, &fd_in, nullptr, nullptr, wemo.timeout(&tv))) {
 
       Log::perror("Error in application select");
 
@@ -151,10 +152,9 @@ int main(int argc, char *argv[], char **envp) {
       }
     }
 
-    if (FD_ISSET(wemo.fd_socket, &fd_in)) {
+    wemo.message(&fd_in);
 
-      std::thread(&WeMo::message, &wemo).detach();
-    }
+    wemo.expire();
   }
 
   close(fd_signal);